@@ -0,0 +1,83 @@
+/*  @file   aot.cpp
+ *  @brief  Runtime for ROMs recompiled ahead of time into C++.
+ *  @author Ryan V. Ngo
+ */
+
+#include "aot.h"
+
+#include <algorithm>
+
+
+#define AOT_ADDR_SPACE        0x1000
+
+
+//---------------------------------------------------
+// rem8Aot
+//---------------------------------------------------
+
+rem8Aot::rem8Aot(const rem8AotProgram& program)
+  : m_program(program),
+    m_block_at(AOT_ADDR_SPACE, -1),
+    m_block_valid(program.block_count, 0),
+    m_code_bytes(AOT_ADDR_SPACE, 0)
+{
+  for (std::size_t i = 0; i < program.block_count; i++) {
+    const rem8AotBlock& block = program.blocks[i];
+    if (block.addr + block.size > AOT_ADDR_SPACE) continue;
+    m_block_at[block.addr] = i;
+    std::fill(m_code_bytes.begin() + block.addr, m_code_bytes.begin() + block.addr + block.size, 1);
+  }
+}
+
+uint32_t rem8Aot::run(rem8Cpp& emulator, uint32_t count) {
+  bool quirks_match = emulator.m_quirks == m_program.quirks;
+  while (count > 0) {
+    uint16_t pc = emulator.m_program_counter;
+    int32_t idx = pc < m_block_at.size() && quirks_match ? m_block_at[pc] : -1;
+    if (idx < 0 || !m_block_valid[idx] || m_program.blocks[idx].length > count) {
+      emulator.cycle();
+      count--;
+      if (emulator._stopped()) return count;
+      continue;
+    }
+
+    const rem8AotBlock& block = m_program.blocks[idx];
+    block.code(emulator);
+    emulator.m_cycle += block.length;
+    count -= block.length;
+  }
+  return 0;
+}
+
+// Re-check every block built from a written byte, blocks come back to life
+// when their bytes are restored (e.g. the same ROM is loaded again)
+void rem8Aot::invalidate(const rem8Cpp& emulator, uint32_t addr, uint32_t size) {
+  std::size_t last = std::min<std::size_t>(std::size_t{addr} + size, m_code_bytes.size());
+  if (addr >= last) return;
+  if (std::find(m_code_bytes.begin() + addr, m_code_bytes.begin() + last, 1) == m_code_bytes.begin() + last) {
+    return;
+  }
+
+  for (std::size_t i = 0; i < m_program.block_count; i++) {
+    const rem8AotBlock& block = m_program.blocks[i];
+    if (block.addr < last && block.addr + block.size > addr) {
+      m_block_valid[i] = _block_matches(emulator, block);
+    }
+  }
+}
+
+
+// Private methods - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - //
+
+bool rem8Aot::_block_matches(const rem8Cpp& emulator, const rem8AotBlock& block) const {
+  if (block.addr < m_program.load_addr) return false;
+  std::size_t rom_offset = block.addr - m_program.load_addr;
+  if (rom_offset + block.size > m_program.rom_size) return false;
+  if (block.addr + block.size > REM8CPP_MEMORY_SIZE) return false;
+  return std::equal(
+      m_program.rom + rom_offset,
+      m_program.rom + rom_offset + block.size,
+      emulator._memory() + block.addr
+  );
+}
+
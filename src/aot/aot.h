@@ -0,0 +1,65 @@
+/*  @file   aot.h
+ *  @brief  Runtime for ROMs recompiled ahead of time into C++.
+ *  @author Ryan V. Ngo
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "emulator.h"
+
+
+// One basic block of a recompiled ROM. length is the number of guest
+// instructions it executes, size the number of ROM bytes it was built from.
+struct rem8AotBlock {
+  uint16_t addr;
+  uint16_t size;
+  uint16_t length;
+  void (*code)(rem8Cpp& emulator);
+};
+
+// Everything rem8C++-aot emits for one ROM. The blocks follow one quirk
+// profile and are only used while the emulator runs with it.
+struct rem8AotProgram {
+  const uint8_t* rom;
+  std::size_t rom_size;
+  uint16_t load_addr;
+  const rem8AotBlock* blocks;
+  std::size_t block_count;
+  rem8Quirks quirks;
+};
+
+
+//---------------------------------------------------
+// rem8Aot
+//---------------------------------------------------
+
+class rem8Aot : public rem8Backend {
+  public:
+    rem8Aot(const rem8AotProgram& program);
+
+    uint32_t run(rem8Cpp& emulator, uint32_t count) override;
+    void invalidate(const rem8Cpp& emulator, uint32_t addr, uint32_t size) override;
+
+    // State accessors for generated code
+    static uint8_t* V(rem8Cpp& emulator) { return emulator.m_data_registers; }
+    static uint32_t& I(rem8Cpp& emulator) { return emulator.m_I_register; }
+    static uint16_t& pc(rem8Cpp& emulator) { return emulator.m_program_counter; }
+
+  private:
+    const rem8AotProgram& m_program;
+
+    // Index into the program's blocks for every address, -1 when none starts there
+    std::vector<int32_t> m_block_at;
+    // Blocks whose ROM bytes still match guest memory
+    std::vector<uint8_t> m_block_valid;
+    // Guest bytes some block was built from
+    std::vector<uint8_t> m_code_bytes;
+
+    bool _block_matches(const rem8Cpp& emulator, const rem8AotBlock& block) const;
+
+};
+
@@ -0,0 +1,342 @@
+/*  @file   recompiler.cpp
+ *  @brief  Static recompiler turning a ROM into a C++ translation unit.
+ *  @author Ryan V. Ngo
+ */
+
+#include "recompiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "emulator.h"
+
+
+#define AOT_ADDR_SPACE        0x1000
+#define AOT_MAX_BLOCK_INSTRS  64
+#define INSTR_SIZE            2
+
+
+namespace {
+
+const char* const s_names[0x10] = {
+  "v0", "v1", "v2", "v3", "v4", "v5", "v6", "v7",
+  "v8", "v9", "vA", "vB", "vC", "vD", "vE", "vF"
+};
+
+// Enumerator names in rem8Quirks order
+const char* const s_quirk_names[] = {"Vip", "Schip", "XoChip", "MegaChip"};
+
+// printf into a std::string
+template <typename... Args>
+std::string format(const char* fmt, Args... args) {
+  char buffer[160];
+  std::snprintf(buffer, sizeof(buffer), fmt, args...);
+  return buffer;
+}
+
+}
+
+
+//---------------------------------------------------
+// rem8Recompiler
+//---------------------------------------------------
+
+rem8Recompiler::rem8Recompiler(const std::vector<char>& rom, uint16_t load_addr, rem8Quirks quirks)
+  : m_memory(AOT_ADDR_SPACE, 0x00),
+    m_rom_size(0),
+    m_load_addr(load_addr),
+    m_quirks(quirks),
+    m_reachable(AOT_ADDR_SPACE, 0),
+    m_leader(AOT_ADDR_SPACE, 0)
+{
+  if (load_addr < AOT_ADDR_SPACE) {
+    m_rom_size = std::min<std::size_t>(rom.size(), AOT_ADDR_SPACE - load_addr);
+    memcpy(&m_memory[load_addr], rom.data(), m_rom_size);
+  }
+
+  _analyse();
+  _build_blocks();
+}
+
+const std::vector<rem8Recompiler::Block>& rem8Recompiler::blocks() const {
+  return m_blocks;
+}
+
+bool rem8Recompiler::reachable(uint16_t addr) const {
+  return addr < AOT_ADDR_SPACE && m_reachable[addr];
+}
+
+bool rem8Recompiler::leader(uint16_t addr) const {
+  return addr < AOT_ADDR_SPACE && m_leader[addr];
+}
+
+std::string rem8Recompiler::generate(const std::string& symbol) const {
+  std::string out;
+  out += "// Generated by rem8C++-aot, do not edit.\n\n";
+  out += "#include \"aot/aot.h\"\n\n\n";
+  out += "namespace {\n\n";
+
+  out += "const uint8_t rom[] = {";
+  for (std::size_t i = 0; i < m_rom_size; i++) {
+    out += (i % 16 == 0) ? "\n  " : " ";
+    out += format("0x%02X,", m_memory[m_load_addr + i]);
+  }
+  if (m_rom_size == 0) out += "0x00";
+  out += "\n};\n\n";
+
+  for (const Block& block : m_blocks) {
+    out += _emit_block(block);
+  }
+
+  if (!m_blocks.empty()) {
+    out += "const rem8AotBlock blocks[] = {\n";
+    for (const Block& block : m_blocks) {
+      out += format("  {0x%04X, 0x%04X, %d, block_%04X},\n",
+          block.addr, block.length * INSTR_SIZE, block.length, block.addr);
+    }
+    out += "};\n\n";
+  }
+
+  out += "}\n\n";
+  out += format("extern const rem8AotProgram %s;\n", symbol.c_str());
+  out += format("const rem8AotProgram %s = {\n", symbol.c_str());
+  out += format("  rom, %zu, 0x%04X,\n", m_rom_size, m_load_addr);
+  out += m_blocks.empty() ? "  nullptr, 0,\n" : "  blocks, sizeof(blocks) / sizeof(blocks[0]),\n";
+  out += format("  rem8Quirks::%s\n", s_quirk_names[static_cast<int>(m_quirks)]);
+  out += "};\n";
+  return out;
+}
+
+
+// Private methods - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - //
+
+bool rem8Recompiler::_in_rom(uint16_t addr) const {
+  return addr >= m_load_addr && std::size_t(addr) + INSTR_SIZE <= m_load_addr + m_rom_size;
+}
+
+uint8_t rem8Recompiler::_opcode_at(uint16_t addr) const {
+  return rem8Cpp::s_opcode_table[rem8Cpp::_dispatch_key(m_memory[addr], m_memory[addr + 1])];
+}
+
+// Walk every path from the load address. BNNN targets and returns are only
+// known at runtime, so they end a path; the runtime interprets from there
+// until it reaches the start of a recompiled block again.
+void rem8Recompiler::_analyse() {
+  const bool long_addressing = rem8Cpp::_visit_quirks(m_quirks, [](auto quirks) { return decltype(quirks)::long_addressing; });
+  std::vector<uint16_t> worklist;
+  auto visit = [&](uint16_t addr, bool leader) {
+    if (!_in_rom(addr)) return;
+    if (leader) m_leader[addr] = 1;
+    if (!m_reachable[addr]) {
+      m_reachable[addr] = 1;
+      worklist.push_back(addr);
+    }
+  };
+
+  visit(m_load_addr, true);
+  while (!worklist.empty()) {
+    uint16_t addr = worklist.back();
+    worklist.pop_back();
+
+    uint16_t next = addr + INSTR_SIZE;
+    rem8Cpp::Operands op = rem8Cpp::_decode(m_memory[addr], m_memory[addr + 1]);
+    switch (_opcode_at(addr)) {
+      case rem8Cpp::OP_F000:
+        // NNNN is data, not an instruction, with long_addressing
+        visit(long_addressing ? next + INSTR_SIZE : next, true);
+        break;
+      case rem8Cpp::OP_01NN:
+        // NNNN follows only in MEGA-CHIP mode, which is decided at runtime
+        visit(next, true);
+        visit(next + INSTR_SIZE, true);
+        break;
+      case rem8Cpp::OP_1NNN:
+        visit(op.NNN, true);
+        break;
+      case rem8Cpp::OP_2NNN:
+        visit(op.NNN, true);
+        visit(next, true);
+        break;
+      case rem8Cpp::OP_3XNN: case rem8Cpp::OP_4XNN: case rem8Cpp::OP_5XY0: case rem8Cpp::OP_9XY0:
+      case rem8Cpp::OP_EX9E: case rem8Cpp::OP_EXA1:
+        visit(next, true);
+        visit(next + INSTR_SIZE, true);
+        if (long_addressing && _in_rom(next) && _opcode_at(next) == rem8Cpp::OP_F000) {
+          visit(next + 2 * INSTR_SIZE, true);
+        }
+        break;
+      case rem8Cpp::OP_00EE: case rem8Cpp::OP_00FD: case rem8Cpp::OP_BNNN:
+        break;
+      case rem8Cpp::OP_0NNN: case rem8Cpp::OP_INVALID: case rem8Cpp::OP_ANNN:
+      case rem8Cpp::OP_6XNN: case rem8Cpp::OP_7XNN:
+      case rem8Cpp::OP_8XY0: case rem8Cpp::OP_8XY1: case rem8Cpp::OP_8XY2: case rem8Cpp::OP_8XY3:
+      case rem8Cpp::OP_8XY4: case rem8Cpp::OP_8XY5: case rem8Cpp::OP_8XY6: case rem8Cpp::OP_8XY7:
+      case rem8Cpp::OP_8XYE: case rem8Cpp::OP_FX1E:
+        visit(next, false);
+        break;
+      default:
+        // Interpreted, the runtime picks up again right after it
+        visit(next, true);
+        break;
+    }
+  }
+}
+
+// One block per leader, running through native instructions up to a jump or
+// skip. Blocks may overlap when control falls into another block's leader.
+void rem8Recompiler::_build_blocks() {
+  const bool long_addressing = rem8Cpp::_visit_quirks(m_quirks, [](auto quirks) { return decltype(quirks)::long_addressing; });
+  for (uint16_t addr = m_load_addr; addr < AOT_ADDR_SPACE; addr++) {
+    if (!m_leader[addr]) continue;
+
+    uint16_t length = 0;
+    bool terminated = false;
+    for (uint16_t pc = addr; _in_rom(pc) && !terminated && length < AOT_MAX_BLOCK_INSTRS; pc += INSTR_SIZE) {
+      bool native = true;
+      switch (_opcode_at(pc)) {
+        case rem8Cpp::OP_0NNN: case rem8Cpp::OP_INVALID: case rem8Cpp::OP_ANNN:
+        case rem8Cpp::OP_6XNN: case rem8Cpp::OP_7XNN:
+        case rem8Cpp::OP_8XY0: case rem8Cpp::OP_8XY1: case rem8Cpp::OP_8XY2: case rem8Cpp::OP_8XY3:
+        case rem8Cpp::OP_8XY4: case rem8Cpp::OP_8XY5: case rem8Cpp::OP_8XY6: case rem8Cpp::OP_8XY7:
+        case rem8Cpp::OP_8XYE: case rem8Cpp::OP_FX1E:
+          break;
+        case rem8Cpp::OP_1NNN:
+          // Idle loops are left to the interpreter, which detects them
+          native = !rem8Cpp::_idle_loop(m_memory.data(), m_memory.size(), pc);
+          terminated = true; break;
+        case rem8Cpp::OP_3XNN: case rem8Cpp::OP_4XNN: case rem8Cpp::OP_5XY0: case rem8Cpp::OP_9XY0:
+          // With long_addressing the skip target depends on whether F000 follows
+          native = !long_addressing;
+          terminated = true; break;
+        default:
+          native = false; break;
+      }
+      if (!native) break;
+      length++;
+    }
+
+    if (length > 0) m_blocks.push_back(Block{addr, length});
+  }
+}
+
+// Mirrors the interpreter's handlers statement for statement. V registers
+// live in locals named after the register so aliasing (X == Y, X == F)
+// behaves exactly like the register file.
+std::string rem8Recompiler::_emit_block(const Block& block) const {
+  bool reads[0x10] = {};
+  bool writes[0x10] = {};
+  bool uses_I = false;
+  const bool vf_reset = rem8Cpp::_visit_quirks(m_quirks, [](auto quirks) { return decltype(quirks)::vf_reset; });
+  const bool shift_vy = rem8Cpp::_visit_quirks(m_quirks, [](auto quirks) { return decltype(quirks)::shift_vy; });
+  const char* reset = vf_reset ? " vF = 0x00;" : "";
+  std::string body;
+  std::string exit;
+
+  for (uint16_t i = 0; i < block.length; i++) {
+    uint16_t addr = block.addr + i * INSTR_SIZE;
+    uint16_t next = addr + INSTR_SIZE;
+    rem8Cpp::Operands op = rem8Cpp::_decode(m_memory[addr], m_memory[addr + 1]);
+    const char* vX = s_names[op.X];
+    const char* vY = s_names[op.Y];
+
+    std::string stmt;
+    switch (_opcode_at(addr)) {
+      case rem8Cpp::OP_0NNN: case rem8Cpp::OP_INVALID:
+        break;
+      case rem8Cpp::OP_ANNN:
+        uses_I = true;
+        stmt = format("I = 0x%03X;", op.NNN);
+        break;
+      case rem8Cpp::OP_6XNN:
+        writes[op.X] = true;
+        stmt = format("%s = 0x%02X;", vX, op.NN);
+        break;
+      case rem8Cpp::OP_7XNN:
+        reads[op.X] = writes[op.X] = true;
+        stmt = format("%s += 0x%02X;", vX, op.NN);
+        break;
+      case rem8Cpp::OP_8XY0:
+        reads[op.Y] = writes[op.X] = true;
+        stmt = format("%s = %s;", vX, vY);
+        break;
+      case rem8Cpp::OP_8XY1:
+        reads[op.X] = reads[op.Y] = writes[op.X] = writes[0xF] = true;
+        stmt = format("%s |= %s;%s", vX, vY, reset);
+        break;
+      case rem8Cpp::OP_8XY2:
+        reads[op.X] = reads[op.Y] = writes[op.X] = writes[0xF] = true;
+        stmt = format("%s &= %s;%s", vX, vY, reset);
+        break;
+      case rem8Cpp::OP_8XY3:
+        reads[op.X] = reads[op.Y] = writes[op.X] = writes[0xF] = true;
+        stmt = format("%s ^= %s;%s", vX, vY, reset);
+        break;
+      case rem8Cpp::OP_8XY4:
+        reads[op.X] = reads[op.Y] = writes[op.X] = writes[0xF] = true;
+        stmt = format("{ uint8_t x0 = %s; %s += %s; vF = %s < x0; }", vX, vX, vY, vX);
+        break;
+      case rem8Cpp::OP_8XY5:
+        reads[op.X] = reads[op.Y] = writes[op.X] = writes[0xF] = true;
+        stmt = format("{ uint8_t x0 = %s; %s -= %s; vF = x0 >= %s; }", vX, vX, vY, vY);
+        break;
+      case rem8Cpp::OP_8XY6:
+        if (!shift_vy) vY = vX;
+        reads[shift_vy ? op.Y : op.X] = writes[op.X] = writes[0xF] = true;
+        stmt = format("{ uint8_t bit = %s & 0x01; %s = %s >> 1; vF = bit; }", vY, vX, vY);
+        break;
+      case rem8Cpp::OP_8XY7:
+        reads[op.X] = reads[op.Y] = writes[op.X] = writes[0xF] = true;
+        stmt = format("{ uint8_t x0 = %s; %s = %s - %s; vF = x0 <= %s; }", vX, vX, vY, vX, vY);
+        break;
+      case rem8Cpp::OP_8XYE:
+        if (!shift_vy) vY = vX;
+        reads[shift_vy ? op.Y : op.X] = writes[op.X] = writes[0xF] = true;
+        stmt = format("{ uint8_t bit = (%s & 0x80) != 0; %s = %s << 1; vF = bit; }", vY, vX, vY);
+        break;
+      case rem8Cpp::OP_FX1E:
+        uses_I = reads[op.X] = true;
+        stmt = format("I += %s;", vX);
+        break;
+      case rem8Cpp::OP_1NNN:
+        exit = format("0x%04X", op.NNN);
+        break;
+      case rem8Cpp::OP_3XNN:
+        reads[op.X] = true;
+        exit = format("%s == 0x%02X ? 0x%04X : 0x%04X", vX, op.NN, next + INSTR_SIZE, next);
+        break;
+      case rem8Cpp::OP_4XNN:
+        reads[op.X] = true;
+        exit = format("%s != 0x%02X ? 0x%04X : 0x%04X", vX, op.NN, next + INSTR_SIZE, next);
+        break;
+      case rem8Cpp::OP_5XY0:
+        reads[op.X] = reads[op.Y] = true;
+        exit = format("%s == %s ? 0x%04X : 0x%04X", vX, vY, next + INSTR_SIZE, next);
+        break;
+      case rem8Cpp::OP_9XY0:
+        reads[op.X] = reads[op.Y] = true;
+        exit = format("%s != %s ? 0x%04X : 0x%04X", vX, vY, next + INSTR_SIZE, next);
+        break;
+    }
+
+    if (!stmt.empty()) body += format("  %-48s // 0x%04X: %02X%02X\n", stmt.c_str(), addr, m_memory[addr], m_memory[addr + 1]);
+  }
+  if (exit.empty()) exit = format("0x%04X", block.addr + block.length * INSTR_SIZE);
+
+  std::string out = format("void block_%04X(rem8Cpp& em) {\n", block.addr);
+  bool any_reg = false;
+  for (int reg = 0; reg < 0x10; reg++) any_reg |= reads[reg] || writes[reg];
+  if (any_reg) out += "  uint8_t* V = rem8Aot::V(em);\n";
+  if (uses_I) out += "  uint32_t& I = rem8Aot::I(em);\n";
+  for (int reg = 0; reg < 0x10; reg++) {
+    if (reads[reg] || writes[reg]) out += format("  uint8_t v%X = V[0x%X];\n", reg, reg);
+  }
+  out += body;
+  for (int reg = 0; reg < 0x10; reg++) {
+    if (writes[reg]) out += format("  V[0x%X] = v%X;\n", reg, reg);
+  }
+  out += "  rem8Aot::pc(em) = " + exit + ";\n";
+  out += "}\n\n";
+  return out;
+}
+
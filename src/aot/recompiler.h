@@ -0,0 +1,55 @@
+/*  @file   recompiler.h
+ *  @brief  Static recompiler turning a ROM into a C++ translation unit.
+ *  @author Ryan V. Ngo
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "emulator.h"
+
+
+//---------------------------------------------------
+// rem8Recompiler
+//---------------------------------------------------
+
+class rem8Recompiler {
+  public:
+    // A straight run of natively translated instructions starting at addr
+    struct Block {
+      uint16_t addr;
+      uint16_t length;
+    };
+
+    rem8Recompiler(const std::vector<char>& rom, uint16_t load_addr = 0x200, rem8Quirks quirks = rem8Quirks::Vip);
+
+    const std::vector<Block>& blocks() const;
+    bool reachable(uint16_t addr) const;
+    bool leader(uint16_t addr) const;
+
+    // C++ source defining `extern const rem8AotProgram <symbol>`
+    std::string generate(const std::string& symbol) const;
+
+  private:
+    std::vector<uint8_t> m_memory;
+    std::size_t m_rom_size;
+    uint16_t m_load_addr;
+    rem8Quirks m_quirks;
+
+    std::vector<uint8_t> m_reachable;
+    std::vector<uint8_t> m_leader;
+    std::vector<Block> m_blocks;
+
+    bool _in_rom(uint16_t addr) const;
+    uint8_t _opcode_at(uint16_t addr) const;
+
+    void _analyse();
+    void _build_blocks();
+    std::string _emit_block(const Block& block) const;
+
+};
+
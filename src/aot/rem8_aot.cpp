@@ -0,0 +1,57 @@
+/*  @file   rem8_aot.cpp
+ *  @brief  rem8C++-aot, recompiles a ROM into a C++ translation unit.
+ *  @author Ryan V. Ngo
+ *
+ *  Usage: rem8C++-aot <rom> <out.cpp> [symbol] [vip|schip|xochip|megachip]
+ *
+ *  The output defines `const rem8AotProgram <symbol>` (default rem8_aot_program)
+ *  to be compiled into the frontend and handed to rem8Cpp's constructor. The
+ *  code follows the given quirk profile (default vip).
+ */
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "aot/recompiler.h"
+#include "utilities/file.h"
+
+
+int main(int argc, char** argv) {
+  if (argc < 3 || argc > 5) {
+    std::cerr << "Usage: " << argv[0] << " <rom> <out.cpp> [symbol] [vip|schip|xochip|megachip]" << std::endl;
+    return -1;
+  }
+
+  rem8Quirks quirks = rem8Quirks::Vip;
+  if (argc == 5) {
+    std::string profile = argv[4];
+    if (profile == "schip") quirks = rem8Quirks::Schip;
+    else if (profile == "xochip") quirks = rem8Quirks::XoChip;
+    else if (profile == "megachip") quirks = rem8Quirks::MegaChip;
+    else if (profile != "vip") {
+      std::cerr << "Unknown quirk profile " << argv[4] << std::endl;
+      return -1;
+    }
+  }
+
+  std::vector<char> rom = open_file(argv[1]);
+  if (rom.empty()) {
+    std::cerr << "Failed to read ROM " << argv[1] << std::endl;
+    return -1;
+  }
+
+  std::string symbol = argc >= 4 ? argv[3] : "rem8_aot_program";
+  rem8Recompiler recompiler{rom, 0x200, quirks};
+
+  std::ofstream out(argv[2]);
+  if (!out) {
+    std::cerr << "Failed to open " << argv[2] << std::endl;
+    return -1;
+  }
+  out << recompiler.generate(symbol);
+
+  std::cout << argv[1] << ": " << recompiler.blocks().size() << " blocks" << std::endl;
+  return 0;
+}
+
@@ -4,143 +4,316 @@
  */
 
 #include "emulator.h"
+#include "jit/jit.h"
+#include "aot/aot.h"
+#include "utilities/rgba.h"
 
 #include <cstdio>
 #include <climits>
 #include <cstring>
-#include <cstdlib>
+#include <algorithm>
+#include <type_traits>
+#include <bit>
 
 
-#define REM8CPP_SCREEN_WIDTH  0x40
-#define REM8CPP_SCREEN_HEIGHT 0x20
-
-#define REM8CPP_MAX_ADDR      0x0FFF
 #define REM8CPP_START_ADDR    0x0200
 
 #define FONT_SET_ADDR         0x0000
 
 #define SPRITE_WIDTH          5
+#define BIG_SPRITE_OFFSET     0x50
+#define BIG_SPRITE_HEIGHT     10
 #define INSTR_SIZE            2
 
 #define KEY_ON                0x1
 #define KEY_OFF               0x0
+#define KEY_NONE              0xFF
+
+#define REM8CPP_CLOCK_RATE    1000
+#define TIMER_HZ              60
+
+#define REM8CPP_RNG_SEED      0x853C49E6748FEA9BULL
+#define RNG_MULTIPLIER        6364136223846793005ULL
+#define RNG_INCREMENT         1442695040888963407ULL
+
+#define IDLE_NO_ADDR          0xFFFF
+#define IDLE_MAX_LOOP_INSTRS  8
+
+#define PLANE_LANES           0x0101010101010101ULL
+#define PLANE_COUNT           2
+
+#define MEGA_BLACK            0xFF000000
+
+#define VIP_FETCH_CYCLES      40
+#define VIP_SPRITE_ROW        16
+#define VIP_SPRITE_SHIFT      4
+#define VIP_SPRITE_SPLIT      8
+#define VIP_REGISTER_CYCLES   14
+
+
+// RGBA (R in the low byte) for the plane bits of a pixel, plane 1 alone is
+// the classic white
+static const std::array<uint32_t, 1 << PLANE_COUNT> s_plane_colors = {
+  0xFF000000,
+  0xFFFFFFFF,
+  0xFFAAAAAA,
+  0xFF555555
+};
+
+// 0xFF in every byte lane of x that is zero, and nowhere else
+static uint64_t zero_lanes(uint64_t x) {
+  const uint64_t low = 0x7F * PLANE_LANES;
+  uint64_t high = ~(((x & low) + low) | x | low);
+  return (high >> 7) * 0xFF;
+}
 
 
 //---------------------------------------------------
-// rem8Cpp
+// rem8State
 //---------------------------------------------------
 
-rem8Cpp::rem8Cpp() 
-  : m_width(REM8CPP_SCREEN_WIDTH),
-    m_height(REM8CPP_SCREEN_HEIGHT),
-    m_screen(m_width * m_height, 0x00),
+static_assert(std::is_trivially_copyable_v<rem8State>, "snapshots are plain copies");
+static_assert(std::endian::native == std::endian::little, "sprites are blitted as little endian words");
+static_assert(REM8CPP_SCREEN_PAD >= 7, "sprite words may overhang the last plane pixel");
+
+rem8State::rem8State()
+  : m_data_registers{},
+    m_I_register(0x0000),
     m_program_counter(0x200),
-    m_stack_pointer(0x200 - 0x01),
+    m_stack_pointer(0x00),
     m_sprite_addr(FONT_SET_ADDR),
+    m_clock_rate(REM8CPP_CLOCK_RATE),
+    m_fault(rem8Fault::None),
+    m_halted(false),
     m_key_pressed(false),
-    m_sound_timer(0x00),
-    m_delay_timer(0x00),
-    m_memory(REM8CPP_MAX_ADDR, 0x00)
+    m_halt_register(0x0),
+    m_cycle(0),
+    m_sound_expiry(0),
+    m_delay_expiry(0),
+    m_halt_key(KEY_NONE),
+    m_exited(false),
+    m_addr_mask(REM8CPP_MEMORY_SIZE - 1),
+    m_planes(0x1),
+    m_lit_planes(0x0),
+    m_megachip(false),
+    m_stack{},
+    m_key{},
+    m_width(REM8CPP_SCREEN_WIDTH),
+    m_height(REM8CPP_SCREEN_HEIGHT),
+    m_rng_state(REM8CPP_RNG_SEED),
+    m_rpl{},
+    m_sprite_width(0),
+    m_sprite_height(0),
+    m_collision_color(0x00),
+    m_blend_mode(REM8CPP_BLEND_NORMAL),
+    m_screen_alpha(0xFF),
+    m_palette{},
+    m_base_memory{},
+    m_base_screen{}
+{
+}
+
+
+//---------------------------------------------------
+// rem8Cpp
+//---------------------------------------------------
+
+rem8Cpp::rem8Cpp(rem8Engine engine) 
+  : m_decoded(REM8CPP_MEMORY_SIZE, DecodedInstr{{}, OP_DECODE, OP_DECODE}),
+    m_engine(engine),
+    m_backend(nullptr),
+    m_quirks(rem8Quirks::Vip),
+    m_handlers(s_handlers<rem8QuirksVip>.data()),
+    m_timing(rem8Timing::Instructions),
+    m_instruction_clock_rate(REM8CPP_CLOCK_RATE),
+    m_cycle_debt(0),
+    m_plane_colors(s_plane_colors),
+    m_idle(false),
+    m_idle_addr(IDLE_NO_ADDR),
+    m_idle_state{},
+    m_drawn(false),
+    m_stop_on_draw(false),
+    m_dirty_rows(rem8DirtyRows().set()),
+    m_frame_generation(0)
 { 
+  if (engine == rem8Engine::Jit) m_backend = std::make_unique<rem8Jit>();
+
   _sprite_set(m_sprite_addr);
-  m_key_binds[0x1] = '1'; m_key_binds[0x2] = '2'; m_key_binds[0x3] = '3'; m_key_binds[0xC] = '4';
-  m_key_binds[0x4] = 'q'; m_key_binds[0x5] = 'w'; m_key_binds[0x6] = 'e'; m_key_binds[0xD] = 'r';
-  m_key_binds[0x7] = 'a'; m_key_binds[0x8] = 's'; m_key_binds[0x9] = 'd'; m_key_binds[0xE] = 'f';
-  m_key_binds[0xA] = 'z'; m_key_binds[0x0] = 'x'; m_key_binds[0xB] = 'c'; m_key_binds[0xF] = 'v';
-  memset(m_key, 0x00, sizeof(uint8_t) * 0x10);
+  _palette_reset();
+}
+
+rem8Cpp::rem8Cpp(const rem8AotProgram& program)
+  : rem8Cpp(rem8Engine::Interpreter)
+{
+  m_engine = rem8Engine::Aot;
+  m_backend = std::make_unique<rem8Aot>(program);
 }
 
+rem8Cpp::~rem8Cpp() = default;
+
+rem8Cpp::rem8Cpp(rem8Cpp&& other) = default;
+rem8Cpp& rem8Cpp::operator=(rem8Cpp&& other) = default;
+
+// Time passes for the timers even while FX0A halts the core
 void rem8Cpp::cycle() {
-  uint8_t msb = m_memory[m_program_counter++];
-  uint8_t lsb = m_memory[m_program_counter++];
-  
+  uint32_t cost = 1;
+  if (!m_halted && !m_exited && m_fault == rem8Fault::None) {
+    m_program_counter &= m_addr_mask;
+    if (m_timing == rem8Timing::Vip) cost = _vip_cycles(_predecode(m_program_counter));
+    const DecodedInstr& instr = m_decoded[m_program_counter];
+    m_program_counter += INSTR_SIZE;
+    m_handlers[instr.opcode](*this, instr.op);
+  }
+  m_cycle += cost;
+}
+
+void rem8Cpp::cycle_reference() {
+  uint32_t cost = 1;
+  if (m_timing == rem8Timing::Vip && !m_halted && !m_exited && m_fault == rem8Fault::None) {
+    cost = _vip_cycles(_predecode(m_program_counter & m_addr_mask));
+  }
+  _visit_quirks(m_quirks, [this](auto quirks) { _cycle_reference<decltype(quirks)>(); });
+  m_cycle += cost;
+}
+
+template <typename Quirks>
+void rem8Cpp::_cycle_reference() {
+  if (m_halted || m_exited || m_fault != rem8Fault::None) return;
+  m_program_counter &= _addr_mask<Quirks>();
+  const uint8_t* memory = _memory<Quirks>();
+  uint8_t msb = memory[m_program_counter++];
+  uint8_t lsb = memory[m_program_counter++];
+  Operands op = _decode(msb, lsb);
   switch (msb & 0xF0) {
     case 0x00:
       switch (msb << 8 | lsb) {
+        case 0x0010:
+          _instr_0010<Quirks>(op); break;
+        case 0x0011:
+          _instr_0011<Quirks>(op); break;
         case 0x00E0:
-          _instr_00E0(); break;
+          _instr_00E0(op); break;
         case 0x00EE:
-          _instr_00EE(); break;
+          _instr_00EE(op); break;
+        case 0x00FB:
+          _instr_00FB<Quirks>(op); break;
+        case 0x00FC:
+          _instr_00FC<Quirks>(op); break;
+        case 0x00FD:
+          _instr_00FD<Quirks>(op); break;
+        case 0x00FE:
+          _instr_00FE<Quirks>(op); break;
+        case 0x00FF:
+          _instr_00FF<Quirks>(op); break;
         default:
-          _instr_0NNN(); break;
+          if (msb == 0x00 && (lsb & 0xF0) == 0xC0) _instr_00CN<Quirks>(op);
+          else if (msb == 0x00 && (lsb & 0xF0) == 0xD0) _instr_00DN<Quirks>(op);
+          else if (msb == 0x00 && (lsb & 0xF0) == 0xB0) _instr_00BN<Quirks>(op);
+          else if (msb == 0x01) _instr_01NN<Quirks>(op);
+          else if (msb == 0x02) _instr_02NN<Quirks>(op);
+          else if (msb == 0x03) _instr_03NN<Quirks>(op);
+          else if (msb == 0x04) _instr_04NN<Quirks>(op);
+          else if (msb == 0x05) _instr_05NN<Quirks>(op);
+          else if (msb == 0x08) _instr_080N<Quirks>(op);
+          else if (msb == 0x09) _instr_09NN<Quirks>(op);
+          else _instr_0NNN(op);
+          break;
       }
       break;
     case 0x10:
-      _instr_1NNN(msb, lsb); break;
+      _instr_1NNN(op); break;
     case 0x20:
-      _instr_2NNN(msb, lsb); break;
+      _instr_2NNN(op); break;
     case 0x30:
-      _instr_3XNN(msb, lsb); break;
+      _instr_3XNN<Quirks>(op); break;
     case 0x40:
-      _instr_4XNN(msb, lsb); break;
+      _instr_4XNN<Quirks>(op); break;
     case 0x50:
-      _instr_5XY0(msb, lsb); break;
+      switch (lsb & 0x0F) {
+        case 0x02:
+          _instr_5XY2<Quirks>(op); break;
+        case 0x03:
+          _instr_5XY3<Quirks>(op); break;
+        default:
+          _instr_5XY0<Quirks>(op); break;
+      }
+      break;
     case 0x60:
-      _instr_6XNN(msb, lsb); break;
+      _instr_6XNN(op); break;
     case 0x70:
-      _instr_7XNN(msb, lsb); break;
+      _instr_7XNN(op); break;
     case 0x80:
       switch (lsb & 0x0F) {
         case 0x00:
-          _instr_8XY0(msb, lsb); break;
+          _instr_8XY0(op); break;
         case 0x01:
-          _instr_8XY1(msb, lsb); break;
+          _instr_8XY1<Quirks>(op); break;
         case 0x02:
-          _instr_8XY2(msb, lsb); break;
+          _instr_8XY2<Quirks>(op); break;
         case 0x03:
-          _instr_8XY3(msb, lsb); break;
+          _instr_8XY3<Quirks>(op); break;
         case 0x04:
-          _instr_8XY4(msb, lsb); break;
+          _instr_8XY4(op); break;
         case 0x05:
-          _instr_8XY5(msb, lsb); break;
+          _instr_8XY5(op); break;
         case 0x06:
-          _instr_8XY6(msb, lsb); break;
+          _instr_8XY6<Quirks>(op); break;
         case 0x07:
-          _instr_8XY7(msb, lsb); break;
+          _instr_8XY7(op); break;
         case 0x0E:
-          _instr_8XYE(msb, lsb); break;
+          _instr_8XYE<Quirks>(op); break;
         default: break;
       }
       break;
     case 0x90:
-      _instr_9XY0(msb, lsb); break;
+      _instr_9XY0<Quirks>(op); break;
     case 0xA0:
-      _instr_ANNN(msb, lsb); break;
+      _instr_ANNN(op); break;
     case 0xB0:
-      _instr_BNNN(msb, lsb); break;
+      _instr_BNNN<Quirks>(op); break;
     case 0xC0:
-      _instr_CXNN(msb, lsb); break;
+      _instr_CXNN(op); break;
     case 0xD0:
-      _instr_DXYN(msb, lsb); break;
+      _instr_DXYN<Quirks>(op); break;
     case 0xE0:
       switch (lsb) {
         case 0x9E:
-          _instr_EX9E(msb); break;
+          _instr_EX9E<Quirks>(op); break;
         case 0xA1:
-          _instr_EXA1(msb); break;
+          _instr_EXA1<Quirks>(op); break;
         default: break;
       }
       break;
     case 0xF0:
       switch (lsb) {
+        case 0x00:
+          _instr_F000<Quirks>(op); break;
+        case 0x01:
+          _instr_FN01<Quirks>(op); break;
         case 0x07:
-          _instr_FX07(msb); break;
+          _instr_FX07(op); break;
         case 0x0A:
-          _instr_FX0A(msb); break;
+          _instr_FX0A(op); break;
         case 0x15:
-          _instr_FX15(msb); break;
+          _instr_FX15(op); break;
         case 0x18:
-          _instr_FX18(msb); break;
+          _instr_FX18(op); break;
         case 0x1E:
-          _instr_FX1E(msb); break;
+          _instr_FX1E(op); break;
         case 0x29:
-          _instr_FX29(msb); break;
+          _instr_FX29(op); break;
+        case 0x30:
+          _instr_FX30<Quirks>(op); break;
         case 0x33:
-          _instr_FX33(msb); break;
+          _instr_FX33(op); break;
         case 0x55:
-          _instr_FX55(msb); break;
+          _instr_FX55<Quirks>(op); break;
         case 0x65:
-          _instr_FX65(msb); break;
+          _instr_FX65<Quirks>(op); break;
+        case 0x75:
+          _instr_FX75<Quirks>(op); break;
+        case 0x85:
+          _instr_FX85<Quirks>(op); break;
         default: break;
       }
       break;
@@ -148,50 +321,559 @@ void rem8Cpp::cycle() {
   }
 }
 
-const std::vector<uint8_t>& rem8Cpp::get_screen() const {
-  return m_screen;
+// Idle loops skip ahead rather than spin, returns the budget left when FX0A
+// blocked the core, it faulted or 00FD exited
+uint32_t rem8Cpp::run(uint32_t count) {
+  m_stop_on_draw = false;
+  while (count > 0) {
+    count = _run(count);
+    if (m_halted || m_exited || m_fault != rem8Fault::None) break;
+    if (m_idle) count -= _skip_idle(count);
+  }
+  return count;
+}
+
+// Run a slice of cycles, returning after a draw, on FX0A or on a fault. Idle
+// loops skip ahead, and so does the rest of the slice while FX0A blocks the core.
+rem8RunResult rem8Cpp::run_batch(uint32_t cycles) {
+  rem8RunResult result{0, 0, rem8Event::None};
+  m_stop_on_draw = true;
+
+  while (result.cycles < cycles) {
+    uint32_t budget = cycles - result.cycles;
+    bool halted = m_halted;
+    uint32_t left = _run(budget);
+    result.cycles += budget - left;
+
+    if (m_fault != rem8Fault::None) {
+      result.event = rem8Event::Fault;
+      break;
+    }
+    if (m_exited) {
+      result.event = rem8Event::Exit;
+      break;
+    }
+    if (m_halted && !halted) {
+      result.event = rem8Event::Halt;
+      break;
+    }
+    if (m_drawn) {
+      result.event = rem8Event::Draw;
+      break;
+    }
+    if (m_idle) {
+      uint32_t skip = _skip_idle(left);
+      result.cycles += skip;
+      result.idle_cycles += skip;
+    }
+    if (m_halted) {
+      m_cycle += left;
+      result.cycles += left;
+      result.event = rem8Event::Halt;
+    }
+  }
+  return result;
+}
+
+// Returns the budget left when stopped early by an idle loop, FX0A, a fault
+// or a draw. Debt left by the last run is paid first, backends only run with
+// instruction timing.
+uint32_t rem8Cpp::_run(uint32_t count) {
+  m_idle = false;
+  m_drawn = false;
+  _reset_idle();
+  if (m_halted || m_exited || m_fault != rem8Fault::None) return count;
+  if (m_cycle_debt > 0) {
+    uint32_t paid = std::min(m_cycle_debt, count);
+    m_cycle_debt -= paid;
+    m_cycle += paid;
+    count -= paid;
+    if (count == 0) return 0;
+  }
+  if (m_backend && m_timing == rem8Timing::Instructions) return m_backend->run(*this, count);
+  return _interpret(count);
+}
+
+// Direct-threaded interpreter, every handler dispatches straight to the next one
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
+uint32_t rem8Cpp::_interpret(uint32_t count) {
+  if (m_timing == rem8Timing::Vip) {
+    return _visit_quirks(m_quirks, [&](auto quirks) { return _run_threaded<decltype(quirks), rem8Timing::Vip>(count); });
+  }
+  return _visit_quirks(m_quirks, [&](auto quirks) { return _run_threaded<decltype(quirks), rem8Timing::Instructions>(count); });
+}
+
+// With VIP timing each instruction is charged its cost as it is fetched, one
+// running past the end of the budget leaves the excess as debt for the next
+// run, and superinstructions run as their first instruction alone
+template <typename Quirks, rem8Timing Timing>
+uint32_t rem8Cpp::_run_threaded(uint32_t count) {
+  static void* const labels[OP_COUNT] = {
+    &&op_invalid,
+    &&op_0NNN,
+    &&op_0010,
+    &&op_0011,
+    &&op_01NN,
+    &&op_02NN,
+    &&op_03NN,
+    &&op_04NN,
+    &&op_05NN,
+    &&op_080N,
+    &&op_09NN,
+    &&op_00BN,
+    &&op_00E0,
+    &&op_00EE,
+    &&op_00CN,
+    &&op_00DN,
+    &&op_00FB,
+    &&op_00FC,
+    &&op_00FD,
+    &&op_00FE,
+    &&op_00FF,
+    &&op_1NNN,
+    &&op_2NNN,
+    &&op_3XNN,
+    &&op_4XNN,
+    &&op_5XY0,
+    &&op_5XY2,
+    &&op_5XY3,
+    &&op_6XNN,
+    &&op_7XNN,
+    &&op_8XY0,
+    &&op_8XY1,
+    &&op_8XY2,
+    &&op_8XY3,
+    &&op_8XY4,
+    &&op_8XY5,
+    &&op_8XY6,
+    &&op_8XY7,
+    &&op_8XYE,
+    &&op_9XY0,
+    &&op_ANNN,
+    &&op_BNNN,
+    &&op_CXNN,
+    &&op_DXYN,
+    &&op_EX9E,
+    &&op_EXA1,
+    &&op_F000,
+    &&op_FN01,
+    &&op_FX07,
+    &&op_FX0A,
+    &&op_FX15,
+    &&op_FX18,
+    &&op_FX1E,
+    &&op_FX29,
+    &&op_FX30,
+    &&op_FX33,
+    &&op_FX55,
+    &&op_FX65,
+    &&op_FX75,
+    &&op_FX85,
+    &&op_ANNN_DXYN,
+    &&op_7XNN_3XNN,
+    &&op_7XNN_4XNN,
+    &&op_6XNN_6XNN,
+    &&op_1NNN_idle,
+    &&op_decode
+  };
+  DecodedInstr instr;
+  Operands& op = instr.op;
+  const uint64_t end = m_cycle + count;
+  uint32_t charged = 1;  // budget taken by the current instruction
+
+// The cycle counter is only written back when leaving, or before an
+// instruction that reads the timers
+#define REM8CPP_RETURN(left)                                    \
+  do {                                                          \
+    m_cycle = end - (left);                                     \
+    return (left);                                              \
+  } while (0)
+
+#define REM8CPP_SYNC_CYCLE() m_cycle = end - count - charged
+
+#define REM8CPP_CHARGE(cost)                                    \
+  do {                                                          \
+    uint32_t cycles = (cost);                                   \
+    uint32_t paid = std::min(cycles, count);                    \
+    m_cycle_debt += cycles - paid;                              \
+    count -= paid;                                              \
+    charged += paid;                                            \
+  } while (0)
+
+#define REM8CPP_DISPATCH()                                      \
+  do {                                                          \
+    if constexpr (Timing == rem8Timing::Vip) {                  \
+      if (count == 0) REM8CPP_RETURN(0);                        \
+    } else {                                                    \
+      if (count-- == 0) REM8CPP_RETURN(0);                      \
+    }                                                           \
+    m_program_counter &= _addr_mask<Quirks>();                  \
+    instr = m_decoded[m_program_counter];                       \
+    m_program_counter += INSTR_SIZE;                            \
+    if constexpr (Timing == rem8Timing::Vip) {                  \
+      charged = 0;                                              \
+      REM8CPP_CHARGE(s_vip_cycles[instr.opcode]);               \
+    }                                                           \
+    goto *labels[instr.fused];                                  \
+  } while (0)
+
+// Superinstructions run two instructions, the first alone when the budget
+// only has room for one
+#define REM8CPP_FUSED(first, second)                            \
+  do {                                                          \
+    if (Timing == rem8Timing::Vip || count == 0) goto *labels[instr.opcode]; \
+    count--;                                                    \
+    first(op);                                                  \
+    instr = m_decoded[m_program_counter];                       \
+    m_program_counter += INSTR_SIZE;                            \
+    second(op);                                                 \
+    REM8CPP_DISPATCH();                                         \
+  } while (0)
+
+  REM8CPP_DISPATCH();
+
+  op_invalid: _instr_invalid(op); REM8CPP_DISPATCH();
+  op_0NNN: _instr_0NNN(op); REM8CPP_DISPATCH();
+  op_0010:
+    _instr_0010<Quirks>(op);
+    if (Quirks::megachip && m_stop_on_draw) REM8CPP_RETURN(count);
+    REM8CPP_DISPATCH();
+  op_0011:
+    _instr_0011<Quirks>(op);
+    if (Quirks::megachip && m_stop_on_draw) REM8CPP_RETURN(count);
+    REM8CPP_DISPATCH();
+  op_01NN: _instr_01NN<Quirks>(op); REM8CPP_DISPATCH();
+  op_02NN: _instr_02NN<Quirks>(op); REM8CPP_DISPATCH();
+  op_03NN: _instr_03NN<Quirks>(op); REM8CPP_DISPATCH();
+  op_04NN: _instr_04NN<Quirks>(op); REM8CPP_DISPATCH();
+  op_05NN: _instr_05NN<Quirks>(op); REM8CPP_DISPATCH();
+  op_080N: _instr_080N<Quirks>(op); REM8CPP_DISPATCH();
+  op_09NN: _instr_09NN<Quirks>(op); REM8CPP_DISPATCH();
+  op_00BN:
+    _instr_00BN<Quirks>(op);
+    if (Quirks::megachip && m_stop_on_draw) REM8CPP_RETURN(count);
+    REM8CPP_DISPATCH();
+  op_00E0:
+    _instr_00E0(op);
+    if (m_stop_on_draw) REM8CPP_RETURN(count);
+    REM8CPP_DISPATCH();
+  op_00EE:
+    _instr_00EE(op);
+    if (m_fault != rem8Fault::None) REM8CPP_RETURN(count);
+    REM8CPP_DISPATCH();
+  op_00CN:
+    _instr_00CN<Quirks>(op);
+    if (m_stop_on_draw) REM8CPP_RETURN(count);
+    REM8CPP_DISPATCH();
+  op_00DN:
+    _instr_00DN<Quirks>(op);
+    if (m_stop_on_draw) REM8CPP_RETURN(count);
+    REM8CPP_DISPATCH();
+  op_00FB:
+    _instr_00FB<Quirks>(op);
+    if (m_stop_on_draw) REM8CPP_RETURN(count);
+    REM8CPP_DISPATCH();
+  op_00FC:
+    _instr_00FC<Quirks>(op);
+    if (m_stop_on_draw) REM8CPP_RETURN(count);
+    REM8CPP_DISPATCH();
+  op_00FD:
+    _instr_00FD<Quirks>(op);
+    if (m_exited) REM8CPP_RETURN(count);
+    REM8CPP_DISPATCH();
+  op_00FE:
+    _instr_00FE<Quirks>(op);
+    if (m_stop_on_draw) REM8CPP_RETURN(count);
+    REM8CPP_DISPATCH();
+  op_00FF:
+    _instr_00FF<Quirks>(op);
+    if (m_stop_on_draw) REM8CPP_RETURN(count);
+    REM8CPP_DISPATCH();
+  op_1NNN: _instr_1NNN(op); REM8CPP_DISPATCH();
+  op_2NNN:
+    _instr_2NNN(op);
+    if (m_fault != rem8Fault::None) REM8CPP_RETURN(count);
+    REM8CPP_DISPATCH();
+  op_3XNN: _instr_3XNN<Quirks>(op); REM8CPP_DISPATCH();
+  op_4XNN: _instr_4XNN<Quirks>(op); REM8CPP_DISPATCH();
+  op_5XY0: _instr_5XY0<Quirks>(op); REM8CPP_DISPATCH();
+  op_5XY2: _instr_5XY2<Quirks>(op); REM8CPP_DISPATCH();
+  op_5XY3: _instr_5XY3<Quirks>(op); REM8CPP_DISPATCH();
+  op_6XNN: _instr_6XNN(op); REM8CPP_DISPATCH();
+  op_7XNN: _instr_7XNN(op); REM8CPP_DISPATCH();
+  op_8XY0: _instr_8XY0(op); REM8CPP_DISPATCH();
+  op_8XY1: _instr_8XY1<Quirks>(op); REM8CPP_DISPATCH();
+  op_8XY2: _instr_8XY2<Quirks>(op); REM8CPP_DISPATCH();
+  op_8XY3: _instr_8XY3<Quirks>(op); REM8CPP_DISPATCH();
+  op_8XY4: _instr_8XY4(op); REM8CPP_DISPATCH();
+  op_8XY5: _instr_8XY5(op); REM8CPP_DISPATCH();
+  op_8XY6: _instr_8XY6<Quirks>(op); REM8CPP_DISPATCH();
+  op_8XY7: _instr_8XY7(op); REM8CPP_DISPATCH();
+  op_8XYE: _instr_8XYE<Quirks>(op); REM8CPP_DISPATCH();
+  op_9XY0: _instr_9XY0<Quirks>(op); REM8CPP_DISPATCH();
+  op_ANNN: _instr_ANNN(op); REM8CPP_DISPATCH();
+  op_BNNN: _instr_BNNN<Quirks>(op); REM8CPP_DISPATCH();
+  op_CXNN: _instr_CXNN(op); REM8CPP_DISPATCH();
+  op_DXYN:
+    if constexpr (Timing == rem8Timing::Vip) REM8CPP_CHARGE(_vip_extra_cycles(OP_DXYN, op));
+    _instr_DXYN<Quirks>(op);
+    if (m_stop_on_draw) REM8CPP_RETURN(count);
+    REM8CPP_DISPATCH();
+  op_EX9E: _instr_EX9E<Quirks>(op); REM8CPP_DISPATCH();
+  op_EXA1: _instr_EXA1<Quirks>(op); REM8CPP_DISPATCH();
+  op_F000: _instr_F000<Quirks>(op); REM8CPP_DISPATCH();
+  op_FN01: _instr_FN01<Quirks>(op); REM8CPP_DISPATCH();
+  op_FX07: REM8CPP_SYNC_CYCLE(); _instr_FX07(op); REM8CPP_DISPATCH();
+  op_FX0A:
+    _instr_FX0A(op);
+    if (m_halted) REM8CPP_RETURN(count);
+    REM8CPP_DISPATCH();
+  op_FX15: REM8CPP_SYNC_CYCLE(); _instr_FX15(op); REM8CPP_DISPATCH();
+  op_FX18: REM8CPP_SYNC_CYCLE(); _instr_FX18(op); REM8CPP_DISPATCH();
+  op_FX1E: _instr_FX1E(op); REM8CPP_DISPATCH();
+  op_FX29: _instr_FX29(op); REM8CPP_DISPATCH();
+  op_FX30: _instr_FX30<Quirks>(op); REM8CPP_DISPATCH();
+  op_FX33: _instr_FX33(op); REM8CPP_DISPATCH();
+  op_FX55:
+    if constexpr (Timing == rem8Timing::Vip) REM8CPP_CHARGE(_vip_extra_cycles(OP_FX55, op));
+    _instr_FX55<Quirks>(op);
+    REM8CPP_DISPATCH();
+  op_FX65:
+    if constexpr (Timing == rem8Timing::Vip) REM8CPP_CHARGE(_vip_extra_cycles(OP_FX65, op));
+    _instr_FX65<Quirks>(op);
+    REM8CPP_DISPATCH();
+  op_FX75: _instr_FX75<Quirks>(op); REM8CPP_DISPATCH();
+  op_FX85: _instr_FX85<Quirks>(op); REM8CPP_DISPATCH();
+  op_ANNN_DXYN:
+    if (m_stop_on_draw) goto *labels[instr.opcode];
+    REM8CPP_FUSED(_instr_ANNN, _instr_DXYN<Quirks>);
+  op_7XNN_3XNN: REM8CPP_FUSED(_instr_7XNN, _instr_3XNN<Quirks>);
+  op_7XNN_4XNN: REM8CPP_FUSED(_instr_7XNN, _instr_4XNN<Quirks>);
+  op_6XNN_6XNN: REM8CPP_FUSED(_instr_6XNN, _instr_6XNN);
+  op_1NNN_idle:
+    REM8CPP_SYNC_CYCLE();
+    _instr_1NNN_idle(op);
+    if (m_idle) REM8CPP_RETURN(count);
+    REM8CPP_DISPATCH();
+  op_decode:
+    instr = _decode_at(m_program_counter - INSTR_SIZE);
+    if constexpr (Timing == rem8Timing::Vip) REM8CPP_CHARGE(s_vip_cycles[instr.opcode]);
+    goto *labels[instr.fused];
+
+#undef REM8CPP_FUSED
+#undef REM8CPP_DISPATCH
+#undef REM8CPP_CHARGE
+#undef REM8CPP_SYNC_CYCLE
+#undef REM8CPP_RETURN
+}
+
+#pragma GCC diagnostic pop
+#else
+
+// Without computed goto, instruction at a time through cycle()
+uint32_t rem8Cpp::_interpret(uint32_t count) {
+  while (count > 0) {
+    uint64_t start = m_cycle;
+    cycle();
+    uint32_t paid = std::min<uint64_t>(m_cycle - start, count);
+    m_cycle_debt += m_cycle - start - paid;
+    m_cycle = start + paid;
+    count -= paid;
+    if (_stopped()) return count;
+  }
+  return 0;
+}
+
+#endif
+
+std::span<const uint8_t> rem8Cpp::get_screen() const {
+  return {_screen(), std::size_t{m_width} * m_height};
+}
+
+void rem8Cpp::get_screen_rgba(std::vector<unsigned char>& buffer) const {
+  get_screen_rgba(buffer, 0, m_height);
+}
+
+const uint32_t* rem8Cpp::palette() const {
+  return m_palette;
 }
 
-void rem8Cpp::get_screen_rgb(std::vector<unsigned char>& buffer) const {
-  for (std::size_t i = 0; i < m_screen.size(); i++) {
-    memset(buffer.data() + i * 3, (m_screen[i] & 0x01) * UCHAR_MAX, sizeof(unsigned char) * 3);
+// Four bytes per pixel, each pixel's plane bits pick its palette entry. Uses
+// the widest kernel the host runs, every width is a multiple of 16 so any run
+// of rows suits them all. MEGA-CHIP mode shows the blended layer, faded by
+// the 05NN alpha.
+void rem8Cpp::get_screen_rgba(std::vector<unsigned char>& buffer, std::size_t first_row, std::size_t rows) const {
+  const std::size_t offset = first_row * m_width;
+  const std::size_t count = rows * m_width;
+  unsigned char* out = buffer.data() + 4 * offset;
+  if (m_megachip) {
+    for (std::size_t row = first_row; row < first_row + rows; row++) {
+      const uint32_t* layer = _layer_row(row);
+      if (m_screen_alpha == 0xFF) {
+        memcpy(out, layer, 4 * m_width);
+        out += 4 * m_width;
+        continue;
+      }
+      for (std::size_t i = 0; i < m_width; i++, out += 4) {
+        memcpy(out, &layer[i], 4);
+        for (int channel = 0; channel < 3; channel++) out[channel] = out[channel] * m_screen_alpha / 0xFF;
+      }
+    }
+    return;
   }
+  static const rem8RgbaKernels& kernels = rgba_kernels().back();
+  kernels.planes(_screen() + offset, count, m_palette, out);
+}
+
+const rem8DirtyRows& rem8Cpp::dirty_rows() const {
+  return m_dirty_rows;
+}
+
+void rem8Cpp::clear_dirty_rows() {
+  m_dirty_rows.reset();
+}
+
+uint64_t rem8Cpp::frame_generation() const {
+  return m_frame_generation;
+}
+
+// Shows right away unless a MEGA-CHIP palette is in use
+void rem8Cpp::set_plane_color(uint8_t planes, uint32_t rgba) {
+  m_plane_colors[planes & 0x03] = rgba;
+  if (!m_megachip) m_palette[planes & 0x03] = rgba;
+  _screen_changed();
 }
 
 void rem8Cpp::set_program_counter(uint16_t addr) {
-  if (addr >= REM8CPP_MAX_ADDR) return;
+  if (addr >= m_addr_mask) return;
   m_program_counter = addr;
+  m_halted = false;
+  m_exited = false;
+  m_fault = rem8Fault::None;
+  _reset_idle();
+}
+
+bool rem8Cpp::load_rom(uint32_t addr, std::vector<char> data, size_t size) {
+  const std::size_t memory_size = _data_mask() + std::size_t{1};
+  if (addr > memory_size || size > memory_size - addr) return false;
+  uint8_t* memory = _memory();
+  memset(memory, 0x00, memory_size + REM8CPP_MEMORY_PAD);
+  _sprite_set(m_sprite_addr);
+  memcpy(&memory[addr], data.data(), size);
+  m_halted = false;
+  m_exited = false;
+  m_stack_pointer = 0x00;
+  m_fault = rem8Fault::None;
+  m_planes = 0x1;
+  if (m_megachip) {
+    m_megachip = false;
+    _palette_reset();
+  }
+  if (m_width != REM8CPP_SCREEN_WIDTH) _set_resolution(REM8CPP_SCREEN_WIDTH, REM8CPP_SCREEN_HEIGHT);
+  _invalidate_code(0x0000, m_addr_mask + 1u);
+  return true;
 }
 
-void rem8Cpp::load_rom(uint16_t addr, std::vector<char> data, size_t size) {
-  if (addr + size >= REM8CPP_MAX_ADDR) return;
-  memset(m_memory.data(), 0x00, sizeof(uint8_t) * m_memory.size());
-  memcpy(&m_memory[addr], data.data(), size);
+// Cycles per emulated second. Vip timing keeps the VIP's clock, the rate is
+// used once back to Instructions.
+void rem8Cpp::set_clock_rate(uint32_t hz) {
+  hz = std::max<uint32_t>(hz, TIMER_HZ);
+  if (m_timing == rem8Timing::Vip) {
+    m_instruction_clock_rate = hz;
+    return;
+  }
+  _set_clock_rate(hz);
 }
 
-void rem8Cpp::update_timers() {
-  if (m_delay_timer > 0) m_delay_timer--;
-  if (m_sound_timer > 0) m_sound_timer--;
+// Timers keep their values across a change but tick on the new rate's
+// boundaries
+void rem8Cpp::_set_clock_rate(uint32_t hz) {
+  if (hz == m_clock_rate) return;
+  uint8_t delay = delay_timer();
+  uint8_t sound = sound_timer();
+  m_clock_rate = hz;
+  m_delay_expiry = _timer_expiry(delay);
+  m_sound_expiry = _timer_expiry(sound);
 }
 
+// Keys are the hex keypad's 0x0-0xF, mapping host keys onto them is up to
+// the frontend
 void rem8Cpp::set_key(uint8_t key) {
-  for (int i = 0; i < 16; i++) {
-    if (m_key_binds[i] == key) {
-      m_key[i] = KEY_ON;
-      m_key_pressed = true;
-      break;
-    }
-  }
+  if (key > 0xF) return;
+  if (m_halted && m_key[key] == KEY_OFF) m_halt_key = key;
+  m_key[key] = KEY_ON;
+  m_key_pressed = true;
+  _reset_idle();
 }
 
 void rem8Cpp::unset_key(uint8_t key) {
-  for (int i = 0; i < 16; i++) {
-    if (m_key_binds[i] == key) {
-      m_key[i] = KEY_OFF;
-      m_key_pressed = false;
-      break;
+  if (key > 0xF) return;
+  if (m_halted && m_key[key] == KEY_ON && m_halt_key == key) {
+    m_data_registers[m_halt_register] = key;
+    m_halted = false;
+  }
+  m_key[key] = KEY_OFF;
+  m_key_pressed = false;
+  _reset_idle();
+}
+
+// Switch to the handlers instantiated for a quirk profile, translated code
+// built for the previous profile is dropped by the backend. The decode cache
+// covers the profile's address space.
+void rem8Cpp::set_quirks(rem8Quirks quirks) {
+  if (quirks == m_quirks) return;
+  m_quirks = quirks;
+  m_handlers = _visit_quirks(quirks, [](auto policy) { return s_handlers<decltype(policy)>.data(); });
+  m_addr_mask = _visit_quirks(quirks, [](auto policy) { return _addr_mask<decltype(policy)>(); });
+  m_program_counter &= m_addr_mask;
+  m_decoded.assign(m_addr_mask + 1u, DecodedInstr{{}, OP_DECODE, OP_DECODE});
+  _reset_idle();
+  if (m_backend) m_backend->invalidate(*this, 0, m_addr_mask + 1u);
+  _fit_profile();
+}
+
+// Vip timing runs at the VIP's clock, leaving it restores the rate set before
+void rem8Cpp::set_timing(rem8Timing timing) {
+  if (timing != m_timing) {
+    if (timing == rem8Timing::Vip) {
+      m_instruction_clock_rate = m_clock_rate;
+      _set_clock_rate(REM8CPP_VIP_CLOCK_RATE);
+    } else {
+      _set_clock_rate(m_instruction_clock_rate);
     }
   }
+  m_timing = timing;
+  m_cycle_debt = 0;
+}
+
+// Seeded the way PCG32 seeds, so any value (zero included) is a good seed
+void rem8Cpp::seed(uint64_t seed) {
+  m_rng_state = (seed + RNG_INCREMENT) * RNG_MULTIPLIER + RNG_INCREMENT;
+}
+
+// A plain copy of the inline block, the extension block is copied too under
+// the profiles that have one
+rem8Snapshot rem8Cpp::snapshot() const {
+  return rem8Snapshot{*this, m_extension};
+}
+
+// Code translated for the previous memory contents is dropped. The address
+// space stays the one of the current quirk profile, a snapshot taken under
+// another is carried over like set_quirks() would.
+void rem8Cpp::restore(const rem8Snapshot& snapshot) {
+  static_cast<rem8State&>(*this) = snapshot.state;
+  m_extension = snapshot.extension;
+  m_addr_mask = static_cast<uint16_t>(m_decoded.size() - 1);
+  _fit_profile();
+  m_idle = false;
+  m_drawn = false;
+  m_cycle_debt = 0;
+  if (m_timing == rem8Timing::Vip) _set_clock_rate(REM8CPP_VIP_CLOCK_RATE);
+  _screen_changed();
+  _invalidate_code(0x0000, m_addr_mask + 1u);
 }
 
 
@@ -209,8 +891,8 @@ uint16_t rem8Cpp::program_counter() const {
   return m_program_counter;
 }
 
-uint8_t rem8Cpp::read_memory(uint16_t addr) const {
-  return m_memory[addr];
+uint8_t rem8Cpp::read_memory(uint32_t addr) const {
+  return _memory()[addr & _data_mask()];
 }
 
 uint8_t rem8Cpp::data_register(uint8_t reg) const {
@@ -218,21 +900,18 @@ uint8_t rem8Cpp::data_register(uint8_t reg) const {
   return m_data_registers[reg];
 }
 
-uint16_t rem8Cpp::I_register() const {
+uint32_t rem8Cpp::I_register() const {
   return m_I_register;
 }
 
+// Return addresses on the call stack
 uint16_t rem8Cpp::stack_pointer() const {
   return m_stack_pointer;
 }
 
 uint8_t rem8Cpp::key(uint8_t key) const {
-  for (int i = 0; i < 16; i++) {
-    if (m_key_binds[i] == key) {
-      return m_key[i];
-    }
-  }
-  return 0xFF;
+  if (key > 0xF) return 0xFF;
+  return m_key[key];
 }
 
 bool rem8Cpp::key_pressed() const {
@@ -240,29 +919,92 @@ bool rem8Cpp::key_pressed() const {
 }
 
 uint8_t rem8Cpp::sound_timer() const {
-  return m_sound_timer;
+  return _timer_value(m_sound_expiry);
 }
 
 uint8_t rem8Cpp::delay_timer() const {
-  return m_delay_timer;
+  return _timer_value(m_delay_expiry);
+}
+
+// Cycles run or skipped since construction
+uint64_t rem8Cpp::cycles() const {
+  return m_cycle;
+}
+
+uint32_t rem8Cpp::clock_rate() const {
+  return m_clock_rate;
+}
+
+rem8Engine rem8Cpp::engine() const {
+  return m_engine;
+}
+
+rem8Quirks rem8Cpp::quirks() const {
+  return m_quirks;
+}
+
+rem8Timing rem8Cpp::timing() const {
+  return m_timing;
+}
+
+// True when the last run() ended skipping a loop waiting on timers or keys
+bool rem8Cpp::idle() const {
+  return m_idle;
+}
+
+// True while FX0A waits for a key, cycle() and run() do nothing until then
+bool rem8Cpp::blocked() const {
+  return m_halted;
+}
+
+// Set when a call or return overflowed or underflowed the stack, cycle() and
+// run() do nothing until set_program_counter() or load_rom()
+rem8Fault rem8Cpp::fault() const {
+  return m_fault;
+}
+
+// 00FD ran, nothing runs until the program counter is set or a ROM is loaded
+bool rem8Cpp::exited() const {
+  return m_exited;
+}
+
+// 0011 switched to MEGA-CHIP mode, until 0010 or a ROM is loaded
+bool rem8Cpp::megachip() const {
+  return m_megachip;
 }
 
 
 // Private methods - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - //
 
-void rem8Cpp::_stack_push_pc() {
-  m_memory[m_stack_pointer] = m_program_counter & 0xFF;
-  m_stack_pointer--;
-  m_memory[m_stack_pointer] = (m_program_counter >> 8) & 0xFF;
-  m_stack_pointer--;
+// PCG32 (XSH RR) step, CXNN takes the top byte of the output
+uint8_t rem8Cpp::_random_byte() {
+  uint64_t state = m_rng_state;
+  m_rng_state = state * RNG_MULTIPLIER + RNG_INCREMENT;
+  uint32_t xorshifted = static_cast<uint32_t>(((state >> 18) ^ state) >> 27);
+  uint32_t rot = static_cast<uint32_t>(state >> 59);
+  uint32_t output = (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+  return output >> 24;
+}
+
+// Return addresses live in m_stack, outside guest memory. A call or return
+// that would leave it faults, rewinding the PC to the offending instruction.
+bool rem8Cpp::_stack_push_pc() {
+  if (m_stack_pointer == REM8CPP_STACK_SIZE) {
+    m_fault = rem8Fault::StackOverflow;
+    m_program_counter -= INSTR_SIZE;
+    return false;
+  }
+  m_stack[m_stack_pointer++] = m_program_counter;
+  return true;
 }
 
 void rem8Cpp::_stack_pull_pc() {
-  m_stack_pointer++;
-  uint8_t msb = m_memory[m_stack_pointer];
-  m_stack_pointer++;
-  uint8_t lsb = m_memory[m_stack_pointer];
-  m_program_counter = (msb << 8) | lsb;
+  if (m_stack_pointer == 0) {
+    m_fault = rem8Fault::StackUnderflow;
+    m_program_counter -= INSTR_SIZE;
+    return;
+  }
+  m_program_counter = m_stack[--m_stack_pointer];
 }
 
 void rem8Cpp::_sprite_set(uint16_t loc) {
@@ -284,136 +1026,1028 @@ void rem8Cpp::_sprite_set(uint16_t loc) {
     0xF0, 0x80, 0xF0, 0x80, 0xF0, /* E */
     0xF0, 0x80, 0xF0, 0x80, 0x80  /* F */
   };
-  memcpy(&m_memory[loc], sprite_data, sizeof(sprite_data));
+  uint8_t big_sprite_data[160] = {
+    0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, /* 0 */
+    0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, /* 1 */
+    0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, /* 2 */
+    0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, /* 3 */
+    0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, /* 4 */
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, /* 5 */
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, /* 6 */
+    0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, /* 7 */
+    0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, /* 8 */
+    0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, /* 9 */
+    0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, /* A */
+    0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, /* B */
+    0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, /* C */
+    0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, /* D */
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, /* E */
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  /* F */
+  };
+  uint8_t* memory = _memory();
+  memcpy(&memory[loc], sprite_data, sizeof(sprite_data));
+  memcpy(&memory[loc + BIG_SPRITE_OFFSET], big_sprite_data, sizeof(big_sprite_data));
 }
 
-char rem8Cpp::_sprite_draw(uint8_t X, uint8_t Y, char height) {
-  char unset = 0;
+// XOR the 8 pixels at screen with the byte lanes of pixels as one word,
+// returns whether a lit pixel was turned off. Lanes past a clipped edge are
+// zero in pixels, so the screen word under them is written back unchanged.
+bool rem8Cpp::_sprite_blit(uint8_t* screen, uint64_t pixels) {
+  uint64_t current;
+  memcpy(&current, screen, sizeof(current));
+  uint64_t updated = current ^ pixels;
+  memcpy(screen, &updated, sizeof(updated));
+  return (current & pixels) != 0;
+}
 
-  std::size_t X_pos = X;
-  std::size_t  Y_pos = Y;
-  if (X >= m_width || Y >= m_height) {
-    X_pos = X % m_width;
-    Y_pos = Y % m_height;
+// Sprites are width (8 or 16) pixels wide and drawn a byte of sprite data,
+// 8 pixels, at a time. The start position always wraps, pixels past the edges
+// are masked off with clip_sprites and wrap around to the other side otherwise.
+// Each selected plane takes the next height rows of sprite data, its pixels
+// are XORed into its own bit of the byte lanes.
+template <typename Quirks>
+char rem8Cpp::_sprite_draw(uint8_t X, uint8_t Y, char height, char width) {
+  bool unset = false;
+  bool drawn = false;
+  std::size_t addr = m_I_register & _data_mask<Quirks>();
+  const uint8_t* memory = _memory<Quirks>();
+  uint8_t* screen = _screen<Quirks>();
+  const int row_bytes = width / 8;
+
+  std::size_t X_pos = X % m_width;
+  std::size_t Y_pos = Y % m_height;
+  m_lit_planes |= m_planes;
+
+  for (int plane = 0; plane < PLANE_COUNT; plane++) {
+    if (!(m_planes & (1 << plane))) continue;
+    for (int y = 0; y < height; y++) {
+      std::size_t row = Y_pos + y;
+      if constexpr (Quirks::clip_sprites) {
+        if (row >= m_height) break;
+      } else {
+        row %= m_height;
+      }
+      for (int byte = 0; byte < row_bytes; byte++) {
+        uint64_t pixels = s_sprite_pixels[memory[addr + y * row_bytes + byte]] << plane;
+        std::size_t col = X_pos + 8 * byte;
+        if constexpr (Quirks::clip_sprites) {
+          if (col >= m_width) continue;
+        } else {
+          col %= m_width;
+        }
+        if (pixels == 0) continue;
+        m_dirty_rows[row] = true;
+        drawn = true;
+
+        if (col + 8 > m_width) {
+          std::size_t count = m_width - col;
+          if constexpr (!Quirks::clip_sprites) {
+            unset |= _sprite_blit(&screen[row * m_width], pixels >> (8 * count));
+          }
+          pixels &= ~uint64_t{0} >> (64 - 8 * count);
+        }
+        unset |= _sprite_blit(&screen[row * m_width + col], pixels);
+      }
+    }
+    addr += height * row_bytes;
   }
 
-  for (int y = 0; y < height; y++) {
-    uint8_t sprite_row = m_memory[m_I_register + y];
-    if (Y_pos + y >= m_height) break;
+  if (drawn) m_frame_generation++;
+  return unset;
+}
+
+// MEGA-CHIP sprites are byte per pixel, index 0 is transparent and every
+// other one replaces the pixel under it, its colour is blended into the
+// layer with the 080N mode. Rows are drawn 8 pixels at a time and clipped or
+// wrapped like other sprites.
+template <typename Quirks>
+char rem8Cpp::_mega_sprite_draw(uint8_t X, uint8_t Y) {
+  bool hit = false;
+  bool drawn = false;
+  const std::size_t width = m_width;
+  std::size_t X_pos = X % width;
+  std::size_t Y_pos = Y % m_height;
+  std::size_t count = std::min<std::size_t>(m_sprite_width, width - X_pos);
+  std::size_t wrapped = std::min<std::size_t>(m_sprite_width - count, X_pos);
+  const uint8_t* memory = _memory<Quirks>();
+  uint8_t* screen = _screen<Quirks>();
+  static const rem8RgbaKernels& kernels = rgba_kernels().back();
+
+  for (std::size_t y = 0; y < m_sprite_height; y++) {
+    std::size_t row = Y_pos + y;
+    if constexpr (Quirks::clip_sprites) {
+      if (row >= m_height) break;
+    } else {
+      row %= m_height;
+    }
+    const uint8_t* sprite = &memory[(m_I_register + y * m_sprite_width) & _data_mask<Quirks>()];
+    bool changed = false;
+    hit |= _mega_blit(&screen[row * width + X_pos], sprite, count, changed);
+    uint32_t* layer = _layer_row(row);
+    changed |= kernels.blend(sprite, count, m_palette, m_blend_mode, layer + X_pos);
+    if constexpr (!Quirks::clip_sprites) {
+      hit |= _mega_blit(&screen[row * width], sprite + count, wrapped, changed);
+      changed |= kernels.blend(sprite + count, wrapped, m_palette, m_blend_mode, layer);
+    }
+    if (changed) {
+      m_dirty_rows[row] = true;
+      drawn = true;
+    }
+  }
+
+  if (drawn) m_frame_generation++;
+  return hit;
+}
+
+// Draw count sprite pixels at screen a word at a time, returns whether an
+// opaque one landed on the collision colour. Sets changed if any pixel did.
+bool rem8Cpp::_mega_blit(uint8_t* screen, const uint8_t* sprite, std::size_t count, bool& changed) {
+  const uint64_t collision = m_collision_color * PLANE_LANES;
+  uint64_t hits = 0;
+  for (std::size_t x = 0; x < count; x += 8) {
+    std::size_t n = std::min<std::size_t>(count - x, 8);
+    uint64_t pixels = 0, current = 0;
+    memcpy(&pixels, sprite + x, n);
+    memcpy(&current, screen + x, n);
+    uint64_t transparent = zero_lanes(pixels);
+    hits |= zero_lanes(current ^ collision) & ~transparent;
+    uint64_t updated = (current & transparent) | pixels;
+    if (updated == current) continue;
+    changed = true;
+    memcpy(screen + x, &updated, n);
+  }
+  return hits != 0;
+}
+
+// Plane colours in the first entries, opaque black in the rest
+void rem8Cpp::_palette_reset() {
+  std::fill(std::begin(m_palette), std::end(m_palette), MEGA_BLACK);
+  std::copy(m_plane_colors.begin(), m_plane_colors.end(), m_palette);
+  _screen_changed();
+}
+
+// Every layer pixel takes the background colour, for clears in MEGA-CHIP mode
+void rem8Cpp::_layer_fill() {
+  std::fill(m_extension.layer.begin(), m_extension.layer.end(), m_palette[0]);
+  m_extension.layer_top = 0;
+}
+
+// Layer row showing screen row, which is below the height like layer_top
+uint32_t* rem8Cpp::_layer_row(std::size_t row) {
+  row += m_extension.layer_top;
+  if (row >= m_height) row -= m_height;
+  return &m_extension.layer[row * m_width];
+}
+
+const uint32_t* rem8Cpp::_layer_row(std::size_t row) const {
+  row += m_extension.layer_top;
+  if (row >= m_height) row -= m_height;
+  return &m_extension.layer[row * m_width];
+}
+
+// Turn the layer's rows down rows (up when negative) and fill the ones
+// brought in with the background, at the cost of those rows alone
+void rem8Cpp::_layer_scroll(int rows) {
+  const std::size_t height = m_height;
+  const std::size_t shift = rows > 0 ? rows : -rows;
+  m_extension.layer_top = (m_extension.layer_top + (rows > 0 ? height - shift : shift)) % height;
+  const std::size_t first = rows > 0 ? 0 : height - shift;
+  for (std::size_t row = first; row < first + shift; row++) {
+    std::fill_n(_layer_row(row), m_width, m_palette[0]);
+  }
+}
+
+// Hold memory and the screen where the current profile keeps them, inline or
+// in an extension block of its size, carrying over what fits. Outside the
+// MEGA-CHIP profile its mode is left too.
+void rem8Cpp::_fit_profile() {
+  const std::size_t mask = _data_mask();
+  const std::size_t memory_size = mask >= REM8CPP_MEMORY_SIZE ? mask + 1u + REM8CPP_MEMORY_PAD : 0;
+  const bool megachip = m_quirks == rem8Quirks::MegaChip;
+  const std::size_t screen_size = megachip ? REM8CPP_MEGA_WIDTH * REM8CPP_MEGA_HEIGHT + REM8CPP_SCREEN_PAD : 0;
+
+  if (memory_size == 0 && !m_extension.memory.empty()) {
+    memcpy(m_base_memory.data(), m_extension.memory.data(), REM8CPP_MEMORY_SIZE);
+    m_extension.memory = {};
+  } else if (memory_size != 0 && m_extension.memory.empty()) {
+    m_extension.memory.assign(memory_size, 0x00);
+    memcpy(m_extension.memory.data(), m_base_memory.data(), REM8CPP_MEMORY_SIZE);
+  } else {
+    m_extension.memory.resize(memory_size, 0x00);
+  }
+
+  if (m_megachip && !megachip) {
+    m_megachip = false;
+    _palette_reset();
+    _set_resolution(REM8CPP_SCREEN_WIDTH, REM8CPP_SCREEN_HEIGHT);
+  }
+  if (!megachip && !m_extension.screen.empty()) {
+    memcpy(m_base_screen.data(), m_extension.screen.data(), m_base_screen.size());
+    m_extension.screen = {};
+    m_extension.layer = {};
+  } else if (megachip && m_extension.screen.empty()) {
+    m_extension.screen.assign(screen_size, 0x00);
+    m_extension.layer.assign(REM8CPP_MEGA_WIDTH * REM8CPP_MEGA_HEIGHT, 0x00000000);
+    memcpy(m_extension.screen.data(), m_base_screen.data(), m_base_screen.size());
+  }
+}
+
+// The current profile's _data_mask(), for handlers shared by all of them
+uint32_t rem8Cpp::_data_mask() const {
+  return _visit_quirks(m_quirks, [](auto policy) { return _data_mask<decltype(policy)>(); });
+}
+
+// Every row is shown again, for changes that move or recolour the whole screen
+void rem8Cpp::_screen_changed() {
+  m_dirty_rows.set();
+  m_frame_generation++;
+}
+
+// Clears the screen, which keeps rows width pixels apart
+void rem8Cpp::_set_resolution(uint16_t width, uint16_t height) {
+  m_width = width;
+  m_height = height;
+  memset(_screen(), 0x00, std::size_t{width} * height);
+  if (m_megachip) _layer_fill();
+  m_lit_planes = 0x0;
+  m_drawn = true;
+  _screen_changed();
+  _reset_idle();
+}
+
+// Move the columns of every row of a width x height buffer right columns
+// (left when negative), filling the ones left behind
+template <typename Pixel>
+static void shift_columns(Pixel* pixels, std::size_t width, std::size_t height, int columns, Pixel fill) {
+  const std::size_t shift = columns > 0 ? columns : -columns;
+  for (std::size_t row = 0; row < height; row++, pixels += width) {
+    if (columns > 0) {
+      memmove(pixels + shift, pixels, (width - shift) * sizeof(Pixel));
+      std::fill_n(pixels, shift, fill);
+    } else {
+      memmove(pixels, pixels + shift, (width - shift) * sizeof(Pixel));
+      std::fill_n(pixels + width - shift, shift, fill);
+    }
+  }
+}
+
+// Scroll the selected planes down rows (up when negative). Whole rows move
+// in MEGA-CHIP mode or while no other plane has lit pixels, otherwise a word of 8 pixels at a
+// time keeping the other planes' bits where they are.
+void rem8Cpp::_scroll_rows(int rows) {
+  const std::size_t width = m_width;
+  const std::size_t height = m_height;
+  uint8_t* screen = _screen();
+  _screen_changed();
+  if (m_megachip || !(m_lit_planes & ~m_planes)) {
+    std::size_t size = width * height;
+    std::size_t shift = std::size_t(rows > 0 ? rows : -rows) * width;
+    if (rows > 0) {
+      memmove(screen + shift, screen, size - shift);
+      memset(screen, 0x00, shift);
+    } else {
+      memmove(screen, screen + shift, size - shift);
+      memset(screen + size - shift, 0x00, shift);
+    }
+    if (m_megachip) _layer_scroll(rows);
+    return;
+  }
+
+  const uint64_t planes = m_planes * PLANE_LANES;
+  for (std::size_t i = 0; i < height; i++) {
+    std::size_t row = rows > 0 ? height - 1 - i : i;
+    std::size_t from = row - rows;
+    uint8_t* pixels = &screen[row * width];
+    const uint8_t* source = from < height ? &screen[from * width] : nullptr;
+    for (std::size_t word = 0; word < width; word += 8) {
+      uint64_t current, moved = 0;
+      memcpy(&current, pixels + word, sizeof(current));
+      if (source) memcpy(&moved, source + word, sizeof(moved));
+      current = (current & ~planes) | (moved & planes);
+      memcpy(pixels + word, &current, sizeof(current));
+    }
+  }
+}
+
+// Scroll the selected planes right columns (left when negative, at most 7
+// either way). With other planes lit each word is shifted, carrying in its
+// neighbour's pixels.
+void rem8Cpp::_scroll_columns(int columns) {
+  const std::size_t width = m_width;
+  const std::size_t height = m_height;
+  const std::size_t shift = columns > 0 ? columns : -columns;
+  uint8_t* screen = _screen();
+  _screen_changed();
+  if (m_megachip || !(m_lit_planes & ~m_planes)) {
+    shift_columns(screen, width, height, columns, uint8_t{0x00});
+    if (m_megachip) shift_columns(m_extension.layer.data(), width, height, columns, m_palette[0]);
+    return;
+  }
+
+  const uint64_t planes = m_planes * PLANE_LANES;
+  for (std::size_t row = 0; row < height; row++) {
+    uint8_t* pixels = &screen[row * width];
+    uint64_t carry = 0;
+    for (std::size_t i = 0; i < width; i += 8) {
+      std::size_t word = columns > 0 ? i : width - 8 - i;
+      uint64_t current, moved;
+      memcpy(&current, pixels + word, sizeof(current));
+      if (columns > 0) {
+        moved = (current << 8 * shift) | carry;
+        carry = current >> (64 - 8 * shift);
+      } else {
+        moved = (current >> 8 * shift) | carry;
+        carry = current << (64 - 8 * shift);
+      }
+      current = (current & ~planes) | (moved & planes);
+      memcpy(pixels + word, &current, sizeof(current));
+    }
+  }
+}
+
+// Step over the instruction that follows, which is four bytes long when it
+// is F000 NNNN and long_addressing is on
+template <typename Quirks>
+void rem8Cpp::_skip() {
+  if constexpr (Quirks::long_addressing) {
+    uint16_t addr = m_program_counter & _addr_mask<Quirks>();
+    const uint8_t* memory = _memory<Quirks>();
+    if (memory[addr] == 0xF0 && memory[addr + 1] == 0x00) m_program_counter += INSTR_SIZE;
+  }
+  m_program_counter += INSTR_SIZE;
+}
+
+rem8Cpp::Operands rem8Cpp::_decode(uint8_t msb, uint8_t lsb) {
+  Operands op;
+  op.opcode = (msb << 8) | lsb;
+  op.X = msb & 0x0F;
+  op.Y = (lsb >> 4) & 0x0F;
+  op.N = lsb & 0x0F;
+  op.NN = lsb;
+  op.NNN = ((msb & 0x0F) << 8) | lsb;
+  return op;
+}
+
+
+// Dispatch tables - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - //
+
+// Mask applied to the lsb when building a dispatch key, indexed by the msb.
+// Only the groups told apart by their low byte keep any lsb bits.
+const std::array<uint8_t, 0x100> rem8Cpp::s_dispatch_mask = [] {
+  std::array<uint8_t, 0x100> mask{};
+  mask[0x00] = 0xFF;
+  for (int X = 0; X < 0x10; X++) {
+    mask[0x50 | X] = 0x0F;
+    mask[0x80 | X] = 0x0F;
+    mask[0xE0 | X] = 0xFF;
+    mask[0xF0 | X] = 0xFF;
+  }
+  return mask;
+}();
+
+// Opcode for every dispatch key, unknown opcodes fall through to OP_INVALID
+const std::array<uint8_t, 0x1010> rem8Cpp::s_opcode_table = [] {
+  std::array<uint8_t, 0x1010> table;
+  table.fill(OP_INVALID);
+  for (int lsb = 0x00; lsb < 0x100; lsb++) table[lsb] = OP_0NNN;
+  for (int msb = 0x01; msb < 0x10; msb++) table[0x1000 | msb] = OP_0NNN;
+  table[0x010] = OP_0010;
+  table[0x011] = OP_0011;
+  table[0x1001] = OP_01NN;
+  table[0x1002] = OP_02NN;
+  table[0x1003] = OP_03NN;
+  table[0x1004] = OP_04NN;
+  table[0x1005] = OP_05NN;
+  table[0x1008] = OP_080N;
+  table[0x1009] = OP_09NN;
+  for (int N = 0x0; N < 0x10; N++) table[0x0B0 | N] = OP_00BN;
+  table[0x0E0] = OP_00E0;
+  table[0x0EE] = OP_00EE;
+  for (int N = 0x0; N < 0x10; N++) table[0x0C0 | N] = OP_00CN;
+  for (int N = 0x0; N < 0x10; N++) table[0x0D0 | N] = OP_00DN;
+  table[0x0FB] = OP_00FB;
+  table[0x0FC] = OP_00FC;
+  table[0x0FD] = OP_00FD;
+  table[0x0FE] = OP_00FE;
+  table[0x0FF] = OP_00FF;
+  table[0x100] = OP_1NNN;
+  table[0x200] = OP_2NNN;
+  table[0x300] = OP_3XNN;
+  table[0x400] = OP_4XNN;
+  for (int N = 0x0; N < 0x10; N++) table[0x500 | N] = OP_5XY0;
+  table[0x502] = OP_5XY2;
+  table[0x503] = OP_5XY3;
+  table[0x600] = OP_6XNN;
+  table[0x700] = OP_7XNN;
+  table[0x800] = OP_8XY0;
+  table[0x801] = OP_8XY1;
+  table[0x802] = OP_8XY2;
+  table[0x803] = OP_8XY3;
+  table[0x804] = OP_8XY4;
+  table[0x805] = OP_8XY5;
+  table[0x806] = OP_8XY6;
+  table[0x807] = OP_8XY7;
+  table[0x80E] = OP_8XYE;
+  table[0x900] = OP_9XY0;
+  table[0xA00] = OP_ANNN;
+  table[0xB00] = OP_BNNN;
+  table[0xC00] = OP_CXNN;
+  table[0xD00] = OP_DXYN;
+  table[0xE9E] = OP_EX9E;
+  table[0xEA1] = OP_EXA1;
+  table[0xF00] = OP_F000;
+  table[0xF01] = OP_FN01;
+  table[0xF07] = OP_FX07;
+  table[0xF0A] = OP_FX0A;
+  table[0xF15] = OP_FX15;
+  table[0xF18] = OP_FX18;
+  table[0xF1E] = OP_FX1E;
+  table[0xF29] = OP_FX29;
+  table[0xF30] = OP_FX30;
+  table[0xF33] = OP_FX33;
+  table[0xF55] = OP_FX55;
+  table[0xF65] = OP_FX65;
+  table[0xF75] = OP_FX75;
+  table[0xF85] = OP_FX85;
+  return table;
+}();
+
+// Each bit of a sprite byte spread over a byte lane, first pixel in the lowest
+const std::array<uint64_t, 0x100> rem8Cpp::s_sprite_pixels = [] {
+  std::array<uint64_t, 0x100> pixels{};
+  for (int bits = 0x00; bits < 0x100; bits++) {
     for (int x = 0; x < 8; x++) {
-      if (X_pos + x >= m_width) continue;
-      uint8_t init_val = m_screen[X_pos + x + (Y_pos + y) * m_width];
-      m_screen[X_pos + x + (Y_pos + y) * m_width] ^= (sprite_row >> (7 - x)) & 0x01;
-      if (m_screen[X_pos + x + (Y_pos + y) * m_width] == 0 && init_val != 0) unset = 1;
+      if (bits & (0x80 >> x)) pixels[bits] |= uint64_t{1} << (8 * x);
     }
   }
+  return pixels;
+}();
+
+// Approximate costs of the VIP interpreter's routines on top of fetching and
+// decoding. Opcodes it never had are charged like a simple one, DXYN, FX55
+// and FX65 add the part depending on their operands in _vip_extra_cycles.
+const std::array<uint8_t, rem8Cpp::OP_COUNT> rem8Cpp::s_vip_cycles = [] {
+  std::array<uint8_t, OP_COUNT> cycles;
+  cycles.fill(VIP_FETCH_CYCLES + 10);
+  cycles[OP_0NNN] = VIP_FETCH_CYCLES;
+  cycles[OP_00E0] = VIP_FETCH_CYCLES + 24;
+  cycles[OP_00EE] = VIP_FETCH_CYCLES + 10;
+  cycles[OP_1NNN] = VIP_FETCH_CYCLES + 12;
+  cycles[OP_1NNN_IDLE] = VIP_FETCH_CYCLES + 12;
+  cycles[OP_2NNN] = VIP_FETCH_CYCLES + 26;
+  cycles[OP_5XY0] = VIP_FETCH_CYCLES + 14;
+  cycles[OP_6XNN] = VIP_FETCH_CYCLES + 6;
+  for (int opcode = OP_8XY0; opcode <= OP_8XYE; opcode++) cycles[opcode] = VIP_FETCH_CYCLES + 44;
+  cycles[OP_9XY0] = VIP_FETCH_CYCLES + 14;
+  cycles[OP_ANNN] = VIP_FETCH_CYCLES + 12;
+  cycles[OP_BNNN] = VIP_FETCH_CYCLES + 22;
+  cycles[OP_CXNN] = VIP_FETCH_CYCLES + 36;
+  cycles[OP_DXYN] = VIP_FETCH_CYCLES + 26;
+  cycles[OP_EX9E] = VIP_FETCH_CYCLES + 14;
+  cycles[OP_EXA1] = VIP_FETCH_CYCLES + 14;
+  cycles[OP_FX1E] = VIP_FETCH_CYCLES + 16;
+  cycles[OP_FX29] = VIP_FETCH_CYCLES + 16;
+  cycles[OP_FX33] = VIP_FETCH_CYCLES + 204;
+  cycles[OP_FX55] = VIP_FETCH_CYCLES + 14;
+  cycles[OP_FX65] = VIP_FETCH_CYCLES + 14;
+  cycles[OP_DECODE] = 0;
+  return cycles;
+}();
+
+// Handler for every opcode, in Opcode order, one table per quirk profile
+template <typename Quirks>
+const rem8Cpp::HandlerTable rem8Cpp::s_handlers = {
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_invalid>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_0NNN>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_0010<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_0011<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_01NN<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_02NN<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_03NN<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_04NN<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_05NN<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_080N<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_09NN<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_00BN<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_00E0>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_00EE>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_00CN<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_00DN<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_00FB<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_00FC<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_00FD<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_00FE<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_00FF<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_1NNN>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_2NNN>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_3XNN<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_4XNN<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_5XY0<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_5XY2<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_5XY3<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_6XNN>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_7XNN>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_8XY0>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_8XY1<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_8XY2<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_8XY3<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_8XY4>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_8XY5>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_8XY6<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_8XY7>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_8XYE<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_9XY0<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_ANNN>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_BNNN<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_CXNN>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_DXYN<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_EX9E<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_EXA1<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_F000<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_FN01<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_FX07>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_FX0A>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_FX15>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_FX18>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_FX1E>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_FX29>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_FX30<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_FX33>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_FX55<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_FX65<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_FX75<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_FX85<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_ANNN_DXYN<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_7XNN_3XNN<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_7XNN_4XNN<Quirks>>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_6XNN_6XNN>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_1NNN_idle>,
+  &rem8Cpp::_thunk<&rem8Cpp::_instr_decode>
+};
+
+// 0x01 - 0x0F are told apart by their msb alone and get keys past 0xFFF
+uint16_t rem8Cpp::_dispatch_key(uint8_t msb, uint8_t lsb) {
+  if (msb - 1u < 0x0F) return 0x1000 | msb;
+  return ((msb & 0xF0) << 4) | (lsb & s_dispatch_mask[msb]);
+}
 
-  return unset;
+rem8Cpp::DecodedInstr rem8Cpp::_predecode(uint16_t addr) const {
+  const uint8_t* memory = _memory();
+  uint8_t msb = memory[addr];
+  uint8_t lsb = memory[addr + 1];
+  uint8_t opcode = s_opcode_table[_dispatch_key(msb, lsb)];
+  if (opcode == OP_1NNN && _idle_loop(memory, m_addr_mask + 1u, addr)) opcode = OP_1NNN_IDLE;
+  return DecodedInstr{_decode(msb, lsb), opcode, _fuse(opcode, uint32_t{addr} + INSTR_SIZE)};
+}
+
+// Superinstruction for opcode followed by the instruction at next, or
+// opcode itself when the pair isn't one worth fusing. Nothing fuses across
+// the top of memory, next is past it there rather than wrapped to 0.
+uint8_t rem8Cpp::_fuse(uint8_t opcode, uint32_t next) const {
+  if (next + 1u >= m_decoded.size()) return opcode;
+  const uint8_t* memory = _memory();
+  uint8_t next_opcode = s_opcode_table[_dispatch_key(memory[next], memory[next + 1])];
+  switch (opcode) {
+    case OP_ANNN:
+      if (next_opcode == OP_DXYN) return OP_ANNN_DXYN;
+      break;
+    case OP_7XNN:
+      if (next_opcode == OP_3XNN) return OP_7XNN_3XNN;
+      if (next_opcode == OP_4XNN) return OP_7XNN_4XNN;
+      break;
+    case OP_6XNN:
+      if (next_opcode == OP_6XNN) return OP_6XNN_6XNN;
+      break;
+  }
+  return opcode;
+}
+
+// Fill the cache entry at addr. A superinstruction takes its second half
+// from the next entry, so that one is filled too, unfused, as its own
+// successor may not be decoded yet.
+const rem8Cpp::DecodedInstr& rem8Cpp::_decode_at(uint16_t addr) {
+  const DecodedInstr& instr = m_decoded[addr] = _predecode(addr);
+  const std::size_t next_addr = std::size_t{addr} + INSTR_SIZE;
+  if (instr.fused != instr.opcode && next_addr < m_decoded.size() && m_decoded[next_addr].opcode == OP_DECODE) {
+    DecodedInstr& next = m_decoded[next_addr] = _predecode(next_addr);
+    next.fused = next.opcode;
+  }
+  return instr;
 }
 
-uint8_t _msb_reg_idx(uint8_t msb) {
-  return msb & 0x0F;
+// Operands of the second half of a superinstruction, stepping over it
+rem8Cpp::Operands rem8Cpp::_fused_next() {
+  Operands next = m_decoded[m_program_counter].op;
+  m_program_counter += INSTR_SIZE;
+  return next;
 }
 
-uint8_t _lsb_reg_idx(uint8_t lsb) {
-  return (lsb >> 4) & 0x0F;
+// Drop decoded entries overlapping [addr, addr + size), including the one
+// starting a byte early whose lsb is at addr and the superinstruction that
+// may start an instruction before that. Backends translate the same range.
+void rem8Cpp::_invalidate_code(uint32_t addr, uint32_t size) {
+  std::size_t first = addr > 0 ? addr - 1 : 0;
+  std::size_t fused_first = addr > 2 ? addr - 3 : 0;
+  std::size_t last = std::min<std::size_t>(std::size_t{addr} + size, m_decoded.size());
+  for (std::size_t i = fused_first; i < last; i++) {
+    m_decoded[i].opcode = OP_DECODE;
+    m_decoded[i].fused = OP_DECODE;
+  }
+  _reset_idle();
+  if (m_backend && first < last) m_backend->invalidate(*this, first, last - first);
+}
+
+// Whether the 1NNN at addr closes a short loop that only polls the delay
+// timer or keys, or jumps to itself. Such a loop can't make progress until
+// a timer tick or a key event once an iteration leaves state unchanged.
+bool rem8Cpp::_idle_loop(const uint8_t* memory, std::size_t size, uint16_t addr) {
+  if (addr + 1u >= size) return false;
+  uint16_t head = _decode(memory[addr], memory[addr + 1]).NNN;
+  if (head > addr || (addr - head) % INSTR_SIZE != 0) return false;
+  if (addr - head > IDLE_MAX_LOOP_INSTRS * INSTR_SIZE) return false;
+
+  bool polls = head == addr;
+  for (uint16_t pc = head; pc < addr; pc += INSTR_SIZE) {
+    switch (s_opcode_table[_dispatch_key(memory[pc], memory[pc + 1])]) {
+      case OP_FX07: case OP_EX9E: case OP_EXA1:
+        polls = true; break;
+      case OP_INVALID: case OP_0NNN:
+      case OP_3XNN: case OP_4XNN: case OP_5XY0: case OP_9XY0:
+      case OP_6XNN: case OP_7XNN:
+      case OP_8XY0: case OP_8XY1: case OP_8XY2: case OP_8XY3:
+      case OP_8XY4: case OP_8XY5: case OP_8XY6: case OP_8XY7: case OP_8XYE:
+      case OP_ANNN: case OP_FX15: case OP_FX18: case OP_FX1E: case OP_FX29:
+        break;
+      default:
+        return false;
+    }
+  }
+  return polls;
+}
+
+// Forget the last idle loop iteration, something outside the loop's own
+// registers changed (memory, screen, random state or host input)
+void rem8Cpp::_reset_idle() {
+  m_idle_addr = IDLE_NO_ADDR;
+}
+
+uint32_t rem8Cpp::_vip_cycles(const DecodedInstr& instr) const {
+  return s_vip_cycles[instr.opcode] + _vip_extra_cycles(instr.opcode, instr.op);
+}
+
+// Every sprite row is shifted into place a bit at a time, and one that is
+// not byte aligned spills into a second byte. FX55/FX65 copy a register
+// at a time.
+uint32_t rem8Cpp::_vip_extra_cycles(uint8_t opcode, Operands op) const {
+  switch (opcode) {
+    case OP_DXYN: {
+      uint32_t rows = op.N ? op.N : 2 * 16;
+      uint32_t shift = m_data_registers[op.X] & 0x07;
+      return rows * (VIP_SPRITE_ROW + shift * VIP_SPRITE_SHIFT + (shift ? VIP_SPRITE_SPLIT : 0));
+    }
+    case OP_FX55: case OP_FX65:
+      return (op.X + 1) * VIP_REGISTER_CYCLES;
+    default:
+      return 0;
+  }
+}
+
+// Nothing but a key event or a timer tick can end an idle loop, so skip up to
+// left cycles, stopping at the delay timer's next tick while it runs
+uint32_t rem8Cpp::_skip_idle(uint32_t left) {
+  uint64_t skip = left;
+  if (delay_timer() > 0) skip = std::min<uint64_t>(skip, _tick_cycle(_timer_ticks(m_cycle) + 1) - m_cycle);
+  m_cycle += skip;
+  return skip;
+}
+
+// Timer ticks since cycle 0, ticks fall on fixed cycle boundaries so timers
+// set at different times still tick together
+uint64_t rem8Cpp::_timer_ticks(uint64_t cycle) const {
+  return cycle * TIMER_HZ / m_clock_rate;
+}
+
+// First cycle at which tick has happened
+uint64_t rem8Cpp::_tick_cycle(uint64_t tick) const {
+  return (tick * m_clock_rate + TIMER_HZ - 1) / TIMER_HZ;
+}
+
+// Expiry cycle of a timer set to value now
+uint64_t rem8Cpp::_timer_expiry(uint8_t value) const {
+  return _tick_cycle(_timer_ticks(m_cycle) + value);
+}
+
+// Value now of a timer expiring at expiry, exact since a clock rate of at
+// least TIMER_HZ never puts two ticks on the same cycle
+uint8_t rem8Cpp::_timer_value(uint64_t expiry) const {
+  if (m_cycle >= expiry) return 0;
+  return _timer_ticks(expiry) - _timer_ticks(m_cycle);
 }
 
 
 // Instructions - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - //
 
+// Unknown opcode, ignored
+void rem8Cpp::_instr_invalid(Operands) {
+  return;
+}
+
 // Execute machine language subroutine at address NNN
-void rem8Cpp::_instr_0NNN() {
+void rem8Cpp::_instr_0NNN(Operands) {
   return;
 }
 
-// Clear the screen
-void rem8Cpp::_instr_00E0() {
-  memset(m_screen.data(), 0x00, m_screen.size() * sizeof(uint8_t));
+// Leave MEGA-CHIP mode for the 64x32 low resolution
+template <typename Quirks>
+void rem8Cpp::_instr_0010(Operands op) {
+  if constexpr (!Quirks::megachip) return _instr_0NNN(op);
+  m_megachip = false;
+  _palette_reset();
+  _set_resolution(REM8CPP_SCREEN_WIDTH, REM8CPP_SCREEN_HEIGHT);
+}
+
+// Enter MEGA-CHIP mode, 256x192 with a byte of palette index per pixel and
+// the colours blended in next to them
+template <typename Quirks>
+void rem8Cpp::_instr_0011(Operands op) {
+  if constexpr (!Quirks::megachip) return _instr_0NNN(op);
+  m_megachip = true;
+  m_blend_mode = REM8CPP_BLEND_NORMAL;
+  m_screen_alpha = 0xFF;
+  _set_resolution(REM8CPP_MEGA_WIDTH, REM8CPP_MEGA_HEIGHT);
+}
+
+// Store NNNNNN, the NN bank byte above the word that follows, in addr
+// register. Only in MEGA-CHIP mode, like 02NN - 09NN.
+template <typename Quirks>
+void rem8Cpp::_instr_01NN(Operands op) {
+  if (!Quirks::megachip || !m_megachip) return _instr_0NNN(op);
+  uint16_t addr = m_program_counter & m_addr_mask;
+  const uint8_t* memory = _memory<Quirks>();
+  m_I_register = (uint32_t{op.NN} << 16) | (memory[addr] << 8) | memory[addr + 1];
+  m_program_counter += INSTR_SIZE;
+}
+
+// Load NN ARGB colours at addr register into palette entries 1 to NN,
+// sprites drawn from then on are coloured with them
+template <typename Quirks>
+void rem8Cpp::_instr_02NN(Operands op) {
+  if (!Quirks::megachip || !m_megachip) return _instr_0NNN(op);
+  constexpr uint32_t mask = _data_mask<Quirks>();
+  uint32_t addr = m_I_register & mask;
+  const uint8_t* memory = _memory<Quirks>();
+  for (int i = 0; i < op.NN && i < 0xFF; i++) {
+    // Up to 1 KB of colours, each byte wraps like any other guest address
+    uint8_t argb[4];
+    for (int k = 0; k < 4; k++) argb[k] = memory[(addr + 4 * i + k) & mask];
+    m_palette[i + 1] = argb[1] | (argb[2] << 8) | (argb[3] << 16) | (uint32_t{argb[0]} << 24);
+  }
+}
+
+// Set the sprite width to NN, 0 is 256
+template <typename Quirks>
+void rem8Cpp::_instr_03NN(Operands op) {
+  if (!Quirks::megachip || !m_megachip) return _instr_0NNN(op);
+  m_sprite_width = op.NN ? op.NN : 0x100;
+}
+
+// Set the sprite height to NN, 0 is 256
+template <typename Quirks>
+void rem8Cpp::_instr_04NN(Operands op) {
+  if (!Quirks::megachip || !m_megachip) return _instr_0NNN(op);
+  m_sprite_height = op.NN ? op.NN : 0x100;
+}
+
+// Fade the whole picture to NN / 255 of its colours, the screen keeps what
+// was drawn
+template <typename Quirks>
+void rem8Cpp::_instr_05NN(Operands op) {
+  if (!Quirks::megachip || !m_megachip) return _instr_0NNN(op);
+  m_screen_alpha = op.NN;
+  _screen_changed();
+}
+
+// Set how DXYN mixes sprite colours into the screen, one of the
+// REM8CPP_BLEND_ modes
+template <typename Quirks>
+void rem8Cpp::_instr_080N(Operands op) {
+  if (!Quirks::megachip || !m_megachip) return _instr_0NNN(op);
+  m_blend_mode = op.NN;
+}
+
+// Set the palette index DXYN reports collisions with
+template <typename Quirks>
+void rem8Cpp::_instr_09NN(Operands op) {
+  if (!Quirks::megachip || !m_megachip) return _instr_0NNN(op);
+  m_collision_color = op.NN;
+}
+
+// Scroll the screen up N rows
+template <typename Quirks>
+void rem8Cpp::_instr_00BN(Operands op) {
+  if constexpr (!Quirks::megachip) return _instr_0NNN(op);
+  _scroll_rows(-op.N);
+  m_drawn = true;
+  _reset_idle();
+}
+
+// Clear the selected planes, or the whole MEGA-CHIP screen
+void rem8Cpp::_instr_00E0(Operands) {
+  std::size_t size = std::size_t{m_width} * m_height;
+  uint8_t* screen = _screen();
+  if (m_megachip || !(m_lit_planes & ~m_planes)) {
+    memset(screen, 0x00, size);
+    if (m_megachip) _layer_fill();
+  } else {
+    const uint64_t planes = m_planes * PLANE_LANES;
+    for (std::size_t i = 0; i < size; i += 8) {
+      uint64_t pixels;
+      memcpy(&pixels, &screen[i], sizeof(pixels));
+      pixels &= ~planes;
+      memcpy(&screen[i], &pixels, sizeof(pixels));
+    }
+  }
+  if (m_megachip || (m_lit_planes & m_planes)) _screen_changed();
+  m_lit_planes &= ~m_planes;
+  m_drawn = true;
+  _reset_idle();
   return;
 }
 
 // Return from a subroutine
-void rem8Cpp::_instr_00EE() {
+void rem8Cpp::_instr_00EE(Operands) {
   _stack_pull_pc();
 }
 
+// Scroll the selected planes down N rows
+template <typename Quirks>
+void rem8Cpp::_instr_00CN(Operands op) {
+  if constexpr (!Quirks::schip_opcodes) return _instr_0NNN(op);
+  _scroll_rows(op.N);
+  m_drawn = true;
+  _reset_idle();
+}
+
+// Scroll the selected planes up N rows
+template <typename Quirks>
+void rem8Cpp::_instr_00DN(Operands op) {
+  if constexpr (!Quirks::xochip_opcodes) return _instr_0NNN(op);
+  _scroll_rows(-op.N);
+  m_drawn = true;
+  _reset_idle();
+}
+
+// Scroll the selected planes right 4 pixels
+template <typename Quirks>
+void rem8Cpp::_instr_00FB(Operands op) {
+  if constexpr (!Quirks::schip_opcodes) return _instr_0NNN(op);
+  _scroll_columns(4);
+  m_drawn = true;
+  _reset_idle();
+}
+
+// Scroll the selected planes left 4 pixels
+template <typename Quirks>
+void rem8Cpp::_instr_00FC(Operands op) {
+  if constexpr (!Quirks::schip_opcodes) return _instr_0NNN(op);
+  _scroll_columns(-4);
+  m_drawn = true;
+  _reset_idle();
+}
+
+// Exit the interpreter
+template <typename Quirks>
+void rem8Cpp::_instr_00FD(Operands op) {
+  if constexpr (!Quirks::schip_opcodes) return _instr_0NNN(op);
+  m_exited = true;
+}
+
+// Switch to the 64x32 low resolution
+template <typename Quirks>
+void rem8Cpp::_instr_00FE(Operands op) {
+  if constexpr (!Quirks::schip_opcodes) return _instr_0NNN(op);
+  _set_resolution(REM8CPP_SCREEN_WIDTH, REM8CPP_SCREEN_HEIGHT);
+}
+
+// Switch to the 128x64 high resolution
+template <typename Quirks>
+void rem8Cpp::_instr_00FF(Operands op) {
+  if constexpr (!Quirks::schip_opcodes) return _instr_0NNN(op);
+  _set_resolution(REM8CPP_HIRES_WIDTH, REM8CPP_HIRES_HEIGHT);
+}
+
 // Jump to address NNN
-void rem8Cpp::_instr_1NNN(uint8_t msb, uint8_t lsb) {
-  m_program_counter = ((msb & 0x0F) << 8) | lsb;
+void rem8Cpp::_instr_1NNN(Operands op) {
+  m_program_counter = op.NNN;
 }
 
 // Execute subroutine starting at address NNN
-void rem8Cpp::_instr_2NNN(uint8_t msb, uint8_t lsb) {
-  _stack_push_pc();
-  m_program_counter = ((msb & 0x0F) << 8) | lsb;
+void rem8Cpp::_instr_2NNN(Operands op) {
+  if (_stack_push_pc()) m_program_counter = op.NNN;
 }
 
 // Skip following instruction if VX == NN
-void rem8Cpp::_instr_3XNN(uint8_t msb, uint8_t lsb) {
-  uint8_t X = _msb_reg_idx(msb);
-  if (m_data_registers[X] == lsb) m_program_counter += INSTR_SIZE;
+template <typename Quirks>
+void rem8Cpp::_instr_3XNN(Operands op) {
+  uint8_t X = op.X;
+  if (m_data_registers[X] == op.NN) _skip<Quirks>();
 }
 
 // Skip following instruction if VX != NN
-void rem8Cpp::_instr_4XNN(uint8_t msb, uint8_t lsb) {
-  uint8_t X = _msb_reg_idx(msb);
-  if (m_data_registers[X] != lsb) m_program_counter += INSTR_SIZE;
+template <typename Quirks>
+void rem8Cpp::_instr_4XNN(Operands op) {
+  uint8_t X = op.X;
+  if (m_data_registers[X] != op.NN) _skip<Quirks>();
 }
 
 // Skip following instruction if VX == VY
-void rem8Cpp::_instr_5XY0(uint8_t msb, uint8_t lsb) {
-  uint8_t X = _msb_reg_idx(msb);
-  uint8_t Y = _lsb_reg_idx(lsb);
-  if (m_data_registers[X] == m_data_registers[Y]) m_program_counter += INSTR_SIZE;
+template <typename Quirks>
+void rem8Cpp::_instr_5XY0(Operands op) {
+  uint8_t X = op.X;
+  uint8_t Y = op.Y;
+  if (m_data_registers[X] == m_data_registers[Y]) _skip<Quirks>();
+}
+
+// Store VX to VY (in that order, either way round) in memory at addr register
+template <typename Quirks>
+void rem8Cpp::_instr_5XY2(Operands op) {
+  if constexpr (!Quirks::xochip_opcodes) return _instr_5XY0<Quirks>(op);
+  uint8_t X = op.X;
+  uint8_t Y = op.Y;
+  uint32_t addr = m_I_register & _data_mask<Quirks>();
+  uint8_t* memory = _memory<Quirks>();
+  int step = X <= Y ? 1 : -1;
+  int count = (Y - X) * step + 1;
+  for (int i = 0; i < count; i++) {
+    memory[addr + i] = m_data_registers[X + i * step];
+  }
+  _invalidate_code(addr, count);
+}
+
+// Fill VX to VY (in that order, either way round) from memory at addr register
+template <typename Quirks>
+void rem8Cpp::_instr_5XY3(Operands op) {
+  if constexpr (!Quirks::xochip_opcodes) return _instr_5XY0<Quirks>(op);
+  uint8_t X = op.X;
+  uint8_t Y = op.Y;
+  uint32_t addr = m_I_register & _data_mask<Quirks>();
+  const uint8_t* memory = _memory<Quirks>();
+  int step = X <= Y ? 1 : -1;
+  int count = (Y - X) * step + 1;
+  for (int i = 0; i < count; i++) {
+    m_data_registers[X + i * step] = memory[addr + i];
+  }
 }
 
 // Store value NN in VX
-void rem8Cpp::_instr_6XNN(uint8_t msb, uint8_t lsb) {
-  uint8_t X = _msb_reg_idx(msb);
-  m_data_registers[X] = lsb;
+void rem8Cpp::_instr_6XNN(Operands op) {
+  uint8_t X = op.X;
+  m_data_registers[X] = op.NN;
 }
 
 // Add value NN to VX
-void rem8Cpp::_instr_7XNN(uint8_t msb, uint8_t lsb) {
-  m_data_registers[msb & 0x0F] += lsb;
+void rem8Cpp::_instr_7XNN(Operands op) {
+  m_data_registers[op.X] += op.NN;
 }
 
 // Store the value of VY in VX
-void rem8Cpp::_instr_8XY0(uint8_t msb, uint8_t lsb) {
-  uint8_t X = _msb_reg_idx(msb);
-  uint8_t Y = _lsb_reg_idx(lsb);
+void rem8Cpp::_instr_8XY0(Operands op) {
+  uint8_t X = op.X;
+  uint8_t Y = op.Y;
   m_data_registers[X] = m_data_registers[Y];
 }
 
-// Set VX to VX | VY , reset 0x0F register
-void rem8Cpp::_instr_8XY1(uint8_t msb, uint8_t lsb) {
-  uint8_t X = _msb_reg_idx(msb);
-  uint8_t Y = _lsb_reg_idx(lsb);
+// Set VX to VX | VY , reset 0x0F register with vf_reset
+template <typename Quirks>
+void rem8Cpp::_instr_8XY1(Operands op) {
+  uint8_t X = op.X;
+  uint8_t Y = op.Y;
   m_data_registers[X] |= m_data_registers[Y];
-  m_data_registers[0x0F] = 0x00;
+  if constexpr (Quirks::vf_reset) m_data_registers[0x0F] = 0x00;
 }
 
-// Set VX to VX & VY , reset 0x0F register
-void rem8Cpp::_instr_8XY2(uint8_t msb, uint8_t lsb) {
-  uint8_t X = _msb_reg_idx(msb);
-  uint8_t Y = _lsb_reg_idx(lsb);
+// Set VX to VX & VY , reset 0x0F register with vf_reset
+template <typename Quirks>
+void rem8Cpp::_instr_8XY2(Operands op) {
+  uint8_t X = op.X;
+  uint8_t Y = op.Y;
   m_data_registers[X] &= m_data_registers[Y];
-  m_data_registers[0x0F] = 0x00;
+  if constexpr (Quirks::vf_reset) m_data_registers[0x0F] = 0x00;
 }
 
-// Set VX to VX ^ VY , reset 0x0F register
-void rem8Cpp::_instr_8XY3(uint8_t msb, uint8_t lsb) {
-  uint8_t X = _msb_reg_idx(msb);
-  uint8_t Y = _lsb_reg_idx(lsb);
+// Set VX to VX ^ VY , reset 0x0F register with vf_reset
+template <typename Quirks>
+void rem8Cpp::_instr_8XY3(Operands op) {
+  uint8_t X = op.X;
+  uint8_t Y = op.Y;
   m_data_registers[X] ^= m_data_registers[Y];
-  m_data_registers[0x0F] = 0x00;
+  if constexpr (Quirks::vf_reset) m_data_registers[0x0F] = 0x00;
 }
 
 // Set VX to VX + VY , if overflow VF = 0x01
-void rem8Cpp::_instr_8XY4(uint8_t msb, uint8_t lsb) {
-  uint8_t X = _msb_reg_idx(msb);
-  uint8_t Y = _lsb_reg_idx(lsb);
+void rem8Cpp::_instr_8XY4(Operands op) {
+  uint8_t X = op.X;
+  uint8_t Y = op.Y;
   uint8_t X_init = m_data_registers[X];
   m_data_registers[X] += m_data_registers[Y];
   if (m_data_registers[X] < X_init) m_data_registers[0x0F] = 0x01;
@@ -421,155 +2055,268 @@ void rem8Cpp::_instr_8XY4(uint8_t msb, uint8_t lsb) {
 }
 
 // Set VX to VX - VY , if borrow VF = 0x00
-void rem8Cpp::_instr_8XY5(uint8_t msb, uint8_t lsb) {
-  uint8_t X = _msb_reg_idx(msb);
-  uint8_t Y = _lsb_reg_idx(lsb);
+void rem8Cpp::_instr_8XY5(Operands op) {
+  uint8_t X = op.X;
+  uint8_t Y = op.Y;
   uint8_t X_init = m_data_registers[X];
   m_data_registers[X] -= m_data_registers[Y];
   if (X_init >= m_data_registers[Y]) m_data_registers[0x0F] = 0x01;
   else m_data_registers[0x0F] = 0x00;
 }
 
-// Set VX to VY >> 1 , set VF to VY LSb
-void rem8Cpp::_instr_8XY6(uint8_t msb, uint8_t lsb) {
-  uint8_t X = _msb_reg_idx(msb);
-  uint8_t Y = _lsb_reg_idx(lsb);
+// Set VX to VY >> 1 , set VF to VY LSb, VX shifts in place without shift_vy
+template <typename Quirks>
+void rem8Cpp::_instr_8XY6(Operands op) {
+  uint8_t X = op.X;
+  uint8_t Y = Quirks::shift_vy ? op.Y : op.X;
   uint8_t lsbit  = m_data_registers[Y] & 0x01;
   m_data_registers[X] = m_data_registers[Y] >> 1;
   m_data_registers[0x0F] = lsbit;
 }
 
 /* Set VX to VY - VX , if borrow VF = 0x00 */
-void rem8Cpp::_instr_8XY7(uint8_t msb, uint8_t lsb) {
-  uint8_t X = _msb_reg_idx(msb);
-  uint8_t Y = _lsb_reg_idx(lsb);
+void rem8Cpp::_instr_8XY7(Operands op) {
+  uint8_t X = op.X;
+  uint8_t Y = op.Y;
   uint8_t X_init = m_data_registers[X];
   m_data_registers[X] = m_data_registers[Y] - m_data_registers[X];
   if (X_init <= m_data_registers[Y]) m_data_registers[0x0F] = 0x01;
   else m_data_registers[0x0F] = 0x00;
 }
 
-/* Set VX to VY << 1 , set VF to VY MSb */
-void rem8Cpp::_instr_8XYE(uint8_t msb, uint8_t lsb) {
-  uint8_t X = _msb_reg_idx(msb);
-  uint8_t Y = _lsb_reg_idx(lsb);
+/* Set VX to VY << 1 , set VF to VY MSb, VX shifts in place without shift_vy */
+template <typename Quirks>
+void rem8Cpp::_instr_8XYE(Operands op) {
+  uint8_t X = op.X;
+  uint8_t Y = Quirks::shift_vy ? op.Y : op.X;
   uint8_t msbit = ((m_data_registers[Y] & 0x80) != 0);
   m_data_registers[X] = m_data_registers[Y] << 1;
   m_data_registers[0x0F] = msbit;
 }
 
 /* Skip following instruction if VX != VY */
-void rem8Cpp::_instr_9XY0(uint8_t msb, uint8_t lsb) {
-  uint8_t X = _msb_reg_idx(msb);
-  uint8_t Y = _lsb_reg_idx(lsb);
-  if (m_data_registers[X] != m_data_registers[Y]) m_program_counter += INSTR_SIZE;
+template <typename Quirks>
+void rem8Cpp::_instr_9XY0(Operands op) {
+  uint8_t X = op.X;
+  uint8_t Y = op.Y;
+  if (m_data_registers[X] != m_data_registers[Y]) _skip<Quirks>();
 }
 
 /* Store NNN in addr register */
-void rem8Cpp::_instr_ANNN(uint8_t msb, uint8_t lsb) {
-  m_I_register = ((msb & 0x0F) << 8) | lsb;
+void rem8Cpp::_instr_ANNN(Operands op) {
+  m_I_register = op.NNN;
 }
 
-/* Jump to address NNN + V0 */
-void rem8Cpp::_instr_BNNN(uint8_t msb, uint8_t lsb) {
-  m_program_counter = (((msb & 0x0F) << 8) | lsb) + m_data_registers[0];
+/* Jump to address NNN + V0, or XNN + VX without jump_v0 */
+template <typename Quirks>
+void rem8Cpp::_instr_BNNN(Operands op) {
+  uint8_t X = Quirks::jump_v0 ? 0x0 : op.X;
+  m_program_counter = (op.NNN) + m_data_registers[X];
 }
 
 /* Set VX to random num with mask NN  */
-void rem8Cpp::_instr_CXNN(uint8_t msb, uint8_t lsb) {
-  uint8_t X = _msb_reg_idx(msb);
-  m_data_registers[X] = (rand() % 0xFF) & lsb;
+void rem8Cpp::_instr_CXNN(Operands op) {
+  uint8_t X = op.X;
+  m_data_registers[X] = _random_byte() & op.NN;
+  _reset_idle();
 }
 
-/* Draw sprite at (VX, VY) 8px wide and Npx tall */
-void rem8Cpp::_instr_DXYN(uint8_t msb, uint8_t lsb) {
-  uint8_t X = _msb_reg_idx(msb);
-  uint8_t Y = _lsb_reg_idx(lsb);
-  uint8_t N = lsb & 0x0F;
-  m_data_registers[0x0F] = _sprite_draw(m_data_registers[X], m_data_registers[Y], N);
+/* Draw sprite at (VX, VY) 8px wide and Npx tall, DXY0 draws a 16x16 sprite,
+   MEGA-CHIP mode draws one of the sprite width and height registers' size */
+template <typename Quirks>
+void rem8Cpp::_instr_DXYN(Operands op) {
+  uint8_t X = op.X;
+  uint8_t Y = op.Y;
+  uint8_t N = op.N;
+  if (Quirks::megachip && m_megachip) {
+    m_data_registers[0x0F] = _mega_sprite_draw<Quirks>(m_data_registers[X], m_data_registers[Y]);
+  } else if (Quirks::schip_opcodes && N == 0) {
+    m_data_registers[0x0F] = _sprite_draw<Quirks>(m_data_registers[X], m_data_registers[Y], 16, 16);
+  } else {
+    m_data_registers[0x0F] = _sprite_draw<Quirks>(m_data_registers[X], m_data_registers[Y], N, 8);
+  }
+  m_drawn = true;
+  _reset_idle();
 }
 
 /* Skip following instruction if key == VX */
-void rem8Cpp::_instr_EX9E(uint8_t msb) {
-  uint8_t X = _msb_reg_idx(msb);
+template <typename Quirks>
+void rem8Cpp::_instr_EX9E(Operands op) {
+  uint8_t X = op.X;
   uint8_t X_val = m_data_registers[X] & 0x0F;
-  if (m_key[X_val] == KEY_ON) m_program_counter += INSTR_SIZE;
+  if (m_key[X_val] == KEY_ON) _skip<Quirks>();
 }
 
 /* Skip following instruction if key != VX */
-void rem8Cpp::_instr_EXA1(uint8_t msb) {
-  uint8_t X = _msb_reg_idx(msb);
+template <typename Quirks>
+void rem8Cpp::_instr_EXA1(Operands op) {
+  uint8_t X = op.X;
   uint8_t X_val = m_data_registers[X] & 0x0F;
-  if (m_key[X_val] == KEY_OFF) m_program_counter += INSTR_SIZE; 
+  if (m_key[X_val] == KEY_OFF) _skip<Quirks>();
+}
+
+/* Store the 16-bit word that follows in addr register, FX00 is otherwise unknown */
+template <typename Quirks>
+void rem8Cpp::_instr_F000(Operands op) {
+  if (!Quirks::long_addressing || op.X != 0x0) return;
+  uint16_t addr = m_program_counter & m_addr_mask;
+  const uint8_t* memory = _memory<Quirks>();
+  m_I_register = (memory[addr] << 8) | memory[addr + 1];
+  m_program_counter += INSTR_SIZE;
+}
+
+/* Select the planes drawn to, cleared and scrolled by the bits of N */
+template <typename Quirks>
+void rem8Cpp::_instr_FN01(Operands op) {
+  if constexpr (!Quirks::xochip_opcodes) return;
+  m_planes = op.X & ((1 << PLANE_COUNT) - 1);
 }
 
 /* Store delay timer into VX */
-void rem8Cpp::_instr_FX07(uint8_t msb) {
-  uint8_t X = _msb_reg_idx(msb);
-  m_data_registers[X] = m_delay_timer;
-}
-
-/* Wait for keypress and store result in VX */
-void rem8Cpp::_instr_FX0A(uint8_t msb) {
-  uint8_t X = _msb_reg_idx(msb);
-  for (int i = 0; i < 16; i++) {
-    if (m_key[i] == KEY_OFF && m_key_pressed) {
-      m_data_registers[X] = i;
-      return;
-    }
-  }
-  m_program_counter -= 2;
+void rem8Cpp::_instr_FX07(Operands op) {
+  uint8_t X = op.X;
+  m_data_registers[X] = delay_timer();
+}
+
+/* Halt until a key is pressed and released, unset_key() stores it in VX */
+void rem8Cpp::_instr_FX0A(Operands op) {
+  m_halted = true;
+  m_halt_register = op.X;
+  m_halt_key = KEY_NONE;
 }
 
 /* Set delay timer to value of VX */
-void rem8Cpp::_instr_FX15(uint8_t msb) {
-  uint8_t X = _msb_reg_idx(msb);
-  m_delay_timer = m_data_registers[X];
+void rem8Cpp::_instr_FX15(Operands op) {
+  uint8_t X = op.X;
+  m_delay_expiry = _timer_expiry(m_data_registers[X]);
 }
 
 /* Set sound timer to value of VX */
-void rem8Cpp::_instr_FX18(uint8_t msb) {
-  uint8_t X = _msb_reg_idx(msb);
-  m_sound_timer = m_data_registers[X];
+void rem8Cpp::_instr_FX18(Operands op) {
+  uint8_t X = op.X;
+  m_sound_expiry = _timer_expiry(m_data_registers[X]);
 }
 
 /* Add value of VX to addr register  */
-void rem8Cpp::_instr_FX1E(uint8_t msb) {
-  uint8_t X = _msb_reg_idx(msb);
+void rem8Cpp::_instr_FX1E(Operands op) {
+  uint8_t X = op.X;
   m_I_register += m_data_registers[X];
 }
 
 /* Set addr register to sprite address of VX */
-void rem8Cpp::_instr_FX29(uint8_t msb) {
-  uint8_t X = _msb_reg_idx(msb);
+void rem8Cpp::_instr_FX29(Operands op) {
+  uint8_t X = op.X;
   m_I_register = m_data_registers[X] * SPRITE_WIDTH + m_sprite_addr;
 }
 
+/* Set addr register to big sprite address of VX */
+template <typename Quirks>
+void rem8Cpp::_instr_FX30(Operands op) {
+  if constexpr (!Quirks::schip_opcodes) return;
+  uint8_t X = op.X;
+  m_I_register = (m_data_registers[X] & 0x0F) * BIG_SPRITE_HEIGHT + m_sprite_addr + BIG_SPRITE_OFFSET;
+}
+
 /* Store BCD of VX at addr of addr register */
-void rem8Cpp::_instr_FX33(uint8_t msb) {
-  uint8_t X = _msb_reg_idx(msb);
+void rem8Cpp::_instr_FX33(Operands op) {
+  uint8_t X = op.X;
   uint8_t val = m_data_registers[X];
+  uint32_t addr = m_I_register & _data_mask();
+  uint8_t* memory = _memory();
   for (int i = 2; i >= 0; i--) {
-    m_memory[m_I_register + i] = val % 10;
+    memory[addr + i] = val % 10;
     val /= 10;
   }
+  _invalidate_code(addr, 3);
 }
 
-/* Store V0 to VX in memory starting at addr register */
-void rem8Cpp::_instr_FX55(uint8_t msb) {
-  uint8_t X = _msb_reg_idx(msb);
+/* Store V0 to VX in memory starting at addr register, then advance it with memory_increment_i */
+template <typename Quirks>
+void rem8Cpp::_instr_FX55(Operands op) {
+  uint8_t X = op.X;
+  uint32_t addr = m_I_register & _data_mask<Quirks>();
+  uint8_t* memory = _memory<Quirks>();
   for (int i = 0; i <= X; i++) {
-    m_memory[m_I_register + i] = m_data_registers[i];
+    memory[addr + i] = m_data_registers[i];
   }
-  m_I_register += X + 1;
+  _invalidate_code(addr, X + 1);
+  if constexpr (Quirks::memory_increment_i) m_I_register += X + 1;
 }
 
-/* Fill V0 to VX from memory starting at addr register */
-void rem8Cpp::_instr_FX65(uint8_t msb) {
-  uint8_t X = _msb_reg_idx(msb);
+/* Fill V0 to VX from memory starting at addr register, then advance it with memory_increment_i */
+template <typename Quirks>
+void rem8Cpp::_instr_FX65(Operands op) {
+  uint8_t X = op.X;
+  uint32_t addr = m_I_register & _data_mask<Quirks>();
+  const uint8_t* memory = _memory<Quirks>();
   for (int i = 0; i <= X; i++) {
-    m_data_registers[i] = m_memory[m_I_register + i] ;
+    m_data_registers[i] = memory[addr + i] ;
   }
-  m_I_register += X + 1;
+  if constexpr (Quirks::memory_increment_i) m_I_register += X + 1;
+}
+
+/* Store V0 to VX in the RPL user flags */
+template <typename Quirks>
+void rem8Cpp::_instr_FX75(Operands op) {
+  if constexpr (!Quirks::schip_opcodes) return;
+  uint8_t X = op.X;
+  memcpy(m_rpl, m_data_registers, X + 1);
+}
+
+/* Fill V0 to VX from the RPL user flags */
+template <typename Quirks>
+void rem8Cpp::_instr_FX85(Operands op) {
+  if constexpr (!Quirks::schip_opcodes) return;
+  uint8_t X = op.X;
+  memcpy(m_data_registers, m_rpl, X + 1);
+}
+
+/* Store NNN in addr register, then draw the DXYN that follows */
+template <typename Quirks>
+void rem8Cpp::_instr_ANNN_DXYN(Operands op) {
+  _instr_ANNN(op);
+  _instr_DXYN<Quirks>(_fused_next());
 }
 
+/* Add NN to VX, then the 3XNN that follows */
+template <typename Quirks>
+void rem8Cpp::_instr_7XNN_3XNN(Operands op) {
+  _instr_7XNN(op);
+  _instr_3XNN<Quirks>(_fused_next());
+}
+
+/* Add NN to VX, then the 4XNN that follows */
+template <typename Quirks>
+void rem8Cpp::_instr_7XNN_4XNN(Operands op) {
+  _instr_7XNN(op);
+  _instr_4XNN<Quirks>(_fused_next());
+}
+
+/* Store NN in VX, then the 6XNN that follows */
+void rem8Cpp::_instr_6XNN_6XNN(Operands op) {
+  _instr_6XNN(op);
+  _instr_6XNN(_fused_next());
+}
+
+/* Jump to the head of a polling loop, the core goes idle once a whole
+   iteration since the last jump left the guest state unchanged */
+void rem8Cpp::_instr_1NNN_idle(Operands op) {
+  IdleState state;
+  memcpy(state.V, m_data_registers, sizeof(state.V));
+  state.I = m_I_register;
+  state.SP = m_stack_pointer;
+  state.delay_timer = delay_timer();
+  state.sound_timer = sound_timer();
+
+  uint16_t addr = m_program_counter - INSTR_SIZE;
+  m_idle = m_idle_addr == addr && state == m_idle_state;
+  m_idle_addr = addr;
+  m_idle_state = state;
+  m_program_counter = op.NNN;
+}
+
+/* Decode the instruction just fetched into the cache, then run it */
+void rem8Cpp::_instr_decode(Operands) {
+  const DecodedInstr& instr = _decode_at(m_program_counter - INSTR_SIZE);
+  m_handlers[instr.opcode](*this, instr.op);
+}
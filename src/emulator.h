@@ -5,103 +5,644 @@
 
 #pragma once
 
+#include <array>
+#include <bitset>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <span>
 #include <vector>
 
 
+#define REM8CPP_SCREEN_WIDTH  0x40
+#define REM8CPP_SCREEN_HEIGHT 0x20
+#define REM8CPP_HIRES_WIDTH   0x80
+#define REM8CPP_HIRES_HEIGHT  0x40
+#define REM8CPP_MEGA_WIDTH    0x100
+#define REM8CPP_MEGA_HEIGHT   0xC0
+#define REM8CPP_MEMORY_SIZE   0x1000
+#define REM8CPP_XO_MEMORY_SIZE 0x10000
+#define REM8CPP_MEGA_MEMORY_SIZE 0x1000000
+#define REM8CPP_MEMORY_PAD    0x100
+#define REM8CPP_SCREEN_PAD    0x08
+#define REM8CPP_STACK_SIZE    0x10
+
+#define REM8CPP_CACHE_LINE    64
+
+// Machine cycles per second of the COSMAC VIP's 1802, clocked at 1.7609 MHz
+// with 8 clocks per machine cycle
+#define REM8CPP_VIP_CLOCK_RATE 220113
+
+
+class rem8Cpp;
+struct rem8AotProgram;
+
+// One byte per pixel holding a bit per plane, or a palette index in MEGA-CHIP
+// mode, rows are width() apart whatever the resolution. Sprite words may
+// overhang the last pixel by up to 7 bytes.
+using rem8Screen = std::array<uint8_t, REM8CPP_HIRES_WIDTH * REM8CPP_HIRES_HEIGHT + REM8CPP_SCREEN_PAD>;
+
+// A bit per screen row, set for rows changed or recoloured
+using rem8DirtyRows = std::bitset<REM8CPP_MEGA_HEIGHT>;
+
+enum class rem8Engine {
+  Interpreter,
+  Jit,
+  Aot
+};
+
+// What a cycle is. Instructions counts every instruction as one, Vip charges
+// each the machine cycles the COSMAC VIP interpreter spends on it and runs
+// at REM8CPP_VIP_CLOCK_RATE. Run budgets, cycles() and the timers all count
+// in the chosen unit.
+enum class rem8Timing : uint8_t {
+  Instructions,
+  Vip
+};
+
+// Why run_batch() handed control back
+enum class rem8Event : uint8_t {
+  None,
+  Draw,
+  Halt,
+  Fault,
+  Exit
+};
+
+// Why the core stopped on an instruction it can't run, it stays stopped
+// until the program counter is set or a ROM is loaded
+enum class rem8Fault : uint8_t {
+  None,
+  StackOverflow,
+  StackUnderflow
+};
+
+// Behaviours the CHIP-8 variants disagree on. A profile is a policy type the
+// quirk-sensitive handlers are instantiated with, so choosing one costs no
+// branches at run time; rem8Quirks picks the instantiation.
+//   vf_reset            8XY1/8XY2/8XY3 clear VF
+//   shift_vy            8XY6/8XYE shift VY into VX rather than VX in place
+//   memory_increment_i  FX55/FX65 leave I past the last register
+//   jump_v0             BNNN adds V0, otherwise BXNN adds VX
+//   clip_sprites        sprites are clipped at the screen edges, otherwise wrap
+//   long_addressing     64 KB of memory, F000 NNNN loads I and skips step over it whole
+//   schip_opcodes       00CN, 00FB - 00FF, FX30, FX75, FX85 and 16x16 DXY0 exist
+//   xochip_opcodes      5XY2, 5XY3, 00DN and FN01 exist
+//   megachip            0010 - 09NN and 00BN are MEGA-CHIP opcodes, otherwise 0NNN,
+//                       and the addr register reaches 16 MB of memory
+// Opcodes a profile lacks behave as on the VIP: 0NNN, the 5XY0 skip or nothing.
+struct rem8QuirksVip {
+  static constexpr bool vf_reset = true;
+  static constexpr bool shift_vy = true;
+  static constexpr bool memory_increment_i = true;
+  static constexpr bool jump_v0 = true;
+  static constexpr bool clip_sprites = true;
+  static constexpr bool long_addressing = false;
+  static constexpr bool schip_opcodes = false;
+  static constexpr bool xochip_opcodes = false;
+  static constexpr bool megachip = false;
+};
+
+struct rem8QuirksSchip {
+  static constexpr bool vf_reset = false;
+  static constexpr bool shift_vy = false;
+  static constexpr bool memory_increment_i = false;
+  static constexpr bool jump_v0 = false;
+  static constexpr bool clip_sprites = true;
+  static constexpr bool long_addressing = false;
+  static constexpr bool schip_opcodes = true;
+  static constexpr bool xochip_opcodes = false;
+  static constexpr bool megachip = false;
+};
+
+struct rem8QuirksXoChip {
+  static constexpr bool vf_reset = false;
+  static constexpr bool shift_vy = true;
+  static constexpr bool memory_increment_i = true;
+  static constexpr bool jump_v0 = true;
+  static constexpr bool clip_sprites = false;
+  static constexpr bool long_addressing = true;
+  static constexpr bool schip_opcodes = true;
+  static constexpr bool xochip_opcodes = true;
+  static constexpr bool megachip = false;
+};
+
+// SUPER-CHIP behaviour, code runs from the first 64 KB and data fills 16 MB
+struct rem8QuirksMegaChip {
+  static constexpr bool vf_reset = false;
+  static constexpr bool shift_vy = false;
+  static constexpr bool memory_increment_i = false;
+  static constexpr bool jump_v0 = false;
+  static constexpr bool clip_sprites = true;
+  static constexpr bool long_addressing = true;
+  static constexpr bool schip_opcodes = true;
+  static constexpr bool xochip_opcodes = false;
+  static constexpr bool megachip = true;
+};
+
+enum class rem8Quirks : uint8_t {
+  Vip,
+  Schip,
+  XoChip,
+  MegaChip
+};
+
+struct rem8RunResult {
+  uint32_t cycles;       // budget used, executed or skipped in idle loops
+  uint32_t idle_cycles;  // part of cycles skipped in idle loops
+  rem8Event event;
+};
+
+
+//---------------------------------------------------
+// rem8Backend
+//---------------------------------------------------
+
+// Execution engine that run() hands its instruction budget to. Every write
+// into guest memory that could hit code is reported through invalidate().
+// run() keeps the emulator's cycle counter up to date and returns the part
+// of the budget left when the program went idle, blocked on FX0A or, in a
+// batch run, drew to the screen.
+class rem8Backend {
+  public:
+    virtual ~rem8Backend() = default;
+    virtual uint32_t run(rem8Cpp& emulator, uint32_t count) = 0;
+    virtual void invalidate(const rem8Cpp& emulator, uint32_t addr, uint32_t size) = 0;
+};
+
+
+//---------------------------------------------------
+// rem8State
+//---------------------------------------------------
+
+// Everything the guest program can observe on CHIP-8 and SUPER-CHIP, held
+// inline so the machine is one trivially copyable block of a few KB and a
+// snapshot is a plain copy of it. The registers, timers and flags every
+// instruction touches fill the first cache line, the keypad and call stack
+// the second, memory and the screen follow. XO-CHIP and MEGA-CHIP keep their
+// larger memory and screen in a rem8Extension instead.
+class rem8State {
+  public:
+    rem8State();
+
+  protected:
+    // First cache line
+    alignas(REM8CPP_CACHE_LINE) uint8_t m_data_registers[0x10];
+    uint32_t m_I_register;
+    uint16_t m_program_counter;
+    uint16_t m_stack_pointer;
+    uint16_t m_sprite_addr;
+    uint32_t m_clock_rate;
+    rem8Fault m_fault;
+    bool m_halted;
+    bool m_key_pressed;
+    uint8_t m_halt_register;
+
+    // Timers are stored as the cycle they reach zero at and read off the
+    // cycle counter, ticking 60 times per clock_rate cycles
+    uint64_t m_cycle;
+    uint64_t m_sound_expiry;
+    uint64_t m_delay_expiry;
+    uint8_t m_halt_key;
+    bool m_exited;
+    uint16_t m_addr_mask;  // 0xFFF, or 0xFFFF with long_addressing
+    uint8_t m_planes;      // XO-CHIP planes drawn to, bit 0 is plane 1
+    uint8_t m_lit_planes;  // planes that may have lit pixels
+    bool m_megachip;       // MEGA-CHIP mode, the screen holds palette indices
+
+    // Second cache line
+    alignas(REM8CPP_CACHE_LINE) uint16_t m_stack[REM8CPP_STACK_SIZE];
+    uint8_t m_key[0x10];
+    uint16_t m_width;
+    uint16_t m_height;
+    uint64_t m_rng_state;  // PCG32 state behind CXNN
+
+    uint8_t m_rpl[0x10];   // SCHIP user flags, kept by FX75 and read by FX85
+
+    // MEGA-CHIP sprites are m_sprite_width x m_sprite_height palette indices
+    uint16_t m_sprite_width;
+    uint16_t m_sprite_height;
+    uint8_t m_collision_color;
+    uint8_t m_blend_mode;       // how DXYN mixes sprite colours in, set by 080N
+    uint8_t m_screen_alpha;     // 05NN fade of the whole picture, 0xFF shows it as drawn
+    uint32_t m_palette[0x100];  // RGBA in memory order for every screen byte
+
+    // Guest addresses are masked with m_addr_mask, or the data mask for the
+    // addr register, where an instruction starts reading, the padding takes
+    // whatever runs off the end from there. Unused while the extension block
+    // holds memory or the screen.
+    alignas(REM8CPP_CACHE_LINE) std::array<uint8_t, REM8CPP_MEMORY_SIZE + REM8CPP_MEMORY_PAD> m_base_memory;
+    rem8Screen m_base_screen;
+};
+
+
+//---------------------------------------------------
+// rem8Extension
+//---------------------------------------------------
+
+// Guest state only the larger platforms have, allocated while a profile that
+// needs it is selected and empty otherwise. memory holds a long_addressing
+// profile's memory and its padding, screen the MEGA-CHIP profile's
+// 256x192 pixels in every mode. layer holds the colours sprites were blended
+// into while MEGA-CHIP mode is on, what get_screen_rgba shows there. Its rows
+// are turned rather than moved by vertical scrolls, screen row 0 is layer
+// row layer_top.
+struct rem8Extension {
+  std::vector<uint8_t> memory;
+  std::vector<uint8_t> screen;
+  std::vector<uint32_t> layer;
+  std::size_t layer_top = 0;
+};
+
+// Guest state to hand back to restore(), the extension is only filled in
+// under the profiles that have one
+struct rem8Snapshot {
+  rem8State state;
+  rem8Extension extension;
+};
+
+
 //---------------------------------------------------
 // rem8Cpp
 //---------------------------------------------------
 
-class rem8Cpp {
+class rem8Cpp : private rem8State {
   public:
-    rem8Cpp();
+    rem8Cpp(rem8Engine engine = rem8Engine::Interpreter);
+    rem8Cpp(const rem8AotProgram& program);
+    ~rem8Cpp();
+
+    rem8Cpp(rem8Cpp&& other);
+    rem8Cpp& operator=(rem8Cpp&& other);
 
     void cycle();
-    const std::vector<uint8_t>& get_screen() const;
-    void get_screen_rgb(std::vector<unsigned char>& buffer) const;
+    void cycle_reference();
+    uint32_t run(uint32_t count);
+    rem8RunResult run_batch(uint32_t cycles);
+
+    // width() * height() bytes, rows width() apart
+    std::span<const uint8_t> get_screen() const;
+    void get_screen_rgba(std::vector<unsigned char>& buffer) const;
+
+    // 0x100 RGBA colours in memory order, the one shown for each screen byte
+    // or, in MEGA-CHIP mode, blended in for it when it is drawn
+    const uint32_t* palette() const;
+
+    // rows rows from first_row on, each written where it sits in the whole
+    // screen's buffer
+    void get_screen_rgba(std::vector<unsigned char>& buffer, std::size_t first_row, std::size_t rows) const;
+
+    // Rows to show again since the last clear_dirty_rows(), all of them
+    // after a resolution, palette or snapshot change
+    const rem8DirtyRows& dirty_rows() const;
+    void clear_dirty_rows();
+
+    // Goes up whenever what get_screen_rgba shows may have changed, a frame
+    // with the same generation as the last one shown needs no redraw
+    uint64_t frame_generation() const;
+
+    // RGBA (R in the low byte) shown for pixels lit in planes, 0 is the
+    // background and 1 the classic foreground. MEGA-CHIP mode starts from these.
+    void set_plane_color(uint8_t planes, uint32_t rgba);
 
     void set_program_counter(uint16_t addr);
-    void load_rom(uint16_t addr, std::vector<char> data, size_t size);
+    // False, leaving memory as it was, when the ROM doesn't fit the profile's
+    // memory from addr on
+    bool load_rom(uint32_t addr, std::vector<char> data, size_t size);
 
-    void update_timers();
+    void set_clock_rate(uint32_t hz);
 
     void set_key(uint8_t key);
     void unset_key(uint8_t key);
 
+    void set_quirks(rem8Quirks quirks);
+
+    // The VIP model runs on the interpreter, translated code counts
+    // instructions
+    void set_timing(rem8Timing timing);
+
+    // Restart CXNN's random sequence, equal seeds give identical runs
+    void seed(uint64_t seed);
+
+    // Guest state to hand back to restore(), engine settings are not part of it
+    rem8Snapshot snapshot() const;
+    void restore(const rem8Snapshot& snapshot);
+
     std::size_t width() const;
     std::size_t height() const;
 
     uint16_t program_counter() const;
-    uint8_t read_memory(uint16_t addr) const;
+    uint8_t read_memory(uint32_t addr) const;
 
     uint8_t data_register(uint8_t reg) const;
-    uint16_t I_register() const;
+    uint32_t I_register() const;
     uint16_t stack_pointer() const;
     uint8_t key(uint8_t key) const;
     bool key_pressed() const;
     uint8_t sound_timer() const;
     uint8_t delay_timer() const;
+    uint64_t cycles() const;
+    uint32_t clock_rate() const;
+    rem8Engine engine() const;
+    rem8Quirks quirks() const;
+    rem8Timing timing() const;
+    bool idle() const;
+    bool blocked() const;
+    rem8Fault fault() const;
+    bool exited() const;
+    bool megachip() const;
 
   private:
-    std::size_t m_width;
-    std::size_t m_height;
-    std::vector<uint8_t> m_screen;
+    friend class rem8Jit;
+    friend class rem8Aot;
+    friend class rem8Recompiler;
 
-    uint8_t m_data_registers[0x10];
-    uint16_t m_I_register;
-    uint16_t m_program_counter;
-    uint16_t m_stack_pointer;
-    uint16_t m_sprite_addr;
-    uint8_t m_key[0x10];
-    uint8_t m_key_binds[0x10];
-    bool m_key_pressed;
-    uint8_t m_sound_timer;
-    uint8_t m_delay_timer;
+    struct Operands {
+      uint16_t opcode;
+      uint16_t NNN;
+      uint8_t NN;
+      uint8_t N;
+      uint8_t X;
+      uint8_t Y;
+    };
+
+    enum Opcode : uint8_t {
+      OP_INVALID,
+      OP_0NNN,
+      OP_0010,
+      OP_0011,
+      OP_01NN,
+      OP_02NN,
+      OP_03NN,
+      OP_04NN,
+      OP_05NN,
+      OP_080N,
+      OP_09NN,
+      OP_00BN,
+      OP_00E0,
+      OP_00EE,
+      OP_00CN,
+      OP_00DN,
+      OP_00FB,
+      OP_00FC,
+      OP_00FD,
+      OP_00FE,
+      OP_00FF,
+      OP_1NNN,
+      OP_2NNN,
+      OP_3XNN,
+      OP_4XNN,
+      OP_5XY0,
+      OP_5XY2,
+      OP_5XY3,
+      OP_6XNN,
+      OP_7XNN,
+      OP_8XY0,
+      OP_8XY1,
+      OP_8XY2,
+      OP_8XY3,
+      OP_8XY4,
+      OP_8XY5,
+      OP_8XY6,
+      OP_8XY7,
+      OP_8XYE,
+      OP_9XY0,
+      OP_ANNN,
+      OP_BNNN,
+      OP_CXNN,
+      OP_DXYN,
+      OP_EX9E,
+      OP_EXA1,
+      OP_F000,
+      OP_FN01,
+      OP_FX07,
+      OP_FX0A,
+      OP_FX15,
+      OP_FX18,
+      OP_FX1E,
+      OP_FX29,
+      OP_FX30,
+      OP_FX33,
+      OP_FX55,
+      OP_FX65,
+      OP_FX75,
+      OP_FX85,
+      OP_ANNN_DXYN,
+      OP_7XNN_3XNN,
+      OP_7XNN_4XNN,
+      OP_6XNN_6XNN,
+      OP_1NNN_IDLE,
+      OP_DECODE,
+      OP_COUNT
+    };
+
+    using Handler = void (*)(rem8Cpp& em, Operands op);
+
+    template <void (rem8Cpp::*Instr)(Operands op)>
+    static void _thunk(rem8Cpp& em, Operands op) { (em.*Instr)(op); }
+
+    static const std::array<uint8_t, 0x100> s_dispatch_mask;
+    static const std::array<uint8_t, 0x1010> s_opcode_table;
+    using HandlerTable = std::array<Handler, OP_COUNT>;
+
+    template <typename Quirks>
+    static const HandlerTable s_handlers;
+
+    // VIP machine cycles per opcode, fetch and decode included
+    static const std::array<uint8_t, OP_COUNT> s_vip_cycles;
+
+    // Calls visitor with a default constructed policy for quirks
+    template <typename Visitor>
+    static auto _visit_quirks(rem8Quirks quirks, Visitor&& visitor) {
+      switch (quirks) {
+        case rem8Quirks::Schip: return visitor(rem8QuirksSchip{});
+        case rem8Quirks::XoChip: return visitor(rem8QuirksXoChip{});
+        case rem8Quirks::MegaChip: return visitor(rem8QuirksMegaChip{});
+        default: return visitor(rem8QuirksVip{});
+      }
+    }
+
+    // Guest addresses wrap at 4 KB, or at 64 KB with long_addressing
+    template <typename Quirks>
+    static constexpr uint16_t _addr_mask() {
+      return Quirks::long_addressing ? REM8CPP_XO_MEMORY_SIZE - 1 : REM8CPP_MEMORY_SIZE - 1;
+    }
+
+    // Addresses read from the addr register wrap at 16 MB in MEGA-CHIP,
+    // where code stays in the first 64 KB
+    template <typename Quirks>
+    static constexpr uint32_t _data_mask() {
+      return Quirks::megachip ? REM8CPP_MEGA_MEMORY_SIZE - 1 : _addr_mask<Quirks>();
+    }
+    uint32_t _data_mask() const;
+
+    // opcode is the instruction alone, fused the superinstruction run() may
+    // use in its place when it also covers the instruction that follows
+    struct DecodedInstr {
+      Operands op;
+      uint8_t opcode;
+      uint8_t fused;
+    };
+
+    std::vector<DecodedInstr> m_decoded;
+    rem8Extension m_extension;
+    rem8Engine m_engine;
+    std::unique_ptr<rem8Backend> m_backend;
+    rem8Quirks m_quirks;
+    const Handler* m_handlers;
+    rem8Timing m_timing;
+    uint32_t m_instruction_clock_rate;  // clock rate to go back to after Vip timing
+    uint32_t m_cycle_debt;  // cycles an instruction ran past the end of its budget
+    std::array<uint32_t, 4> m_plane_colors;
 
-    std::vector<uint8_t> m_memory;
+    // Guest state a polling loop can change, compared across its iterations
+    struct IdleState {
+      uint8_t V[0x10];
+      uint32_t I;
+      uint16_t SP;
+      uint8_t delay_timer;
+      uint8_t sound_timer;
 
-    void _stack_push_pc();
+      bool operator==(const IdleState& other) const = default;
+    };
+
+    bool m_idle;
+    uint16_t m_idle_addr;
+    IdleState m_idle_state;
+
+    bool m_drawn;
+    bool m_stop_on_draw;
+    rem8DirtyRows m_dirty_rows;
+    uint64_t m_frame_generation;
+
+    void _screen_changed();
+
+    // Memory and the screen, inline or in the extension block. The profile
+    // a handler is instantiated with knows which without looking.
+    uint8_t* _memory() { return m_extension.memory.empty() ? m_base_memory.data() : m_extension.memory.data(); }
+    const uint8_t* _memory() const { return m_extension.memory.empty() ? m_base_memory.data() : m_extension.memory.data(); }
+    uint8_t* _screen() { return m_extension.screen.empty() ? m_base_screen.data() : m_extension.screen.data(); }
+    const uint8_t* _screen() const { return m_extension.screen.empty() ? m_base_screen.data() : m_extension.screen.data(); }
+    template <typename Quirks>
+    uint8_t* _memory() { return Quirks::long_addressing ? m_extension.memory.data() : m_base_memory.data(); }
+    template <typename Quirks>
+    uint8_t* _screen() { return Quirks::megachip ? m_extension.screen.data() : m_base_screen.data(); }
+    void _fit_profile();
+
+    void _set_clock_rate(uint32_t hz);
+    uint32_t _run(uint32_t count);
+    uint32_t _interpret(uint32_t count);
+    template <typename Quirks, rem8Timing Timing> uint32_t _run_threaded(uint32_t count);
+    template <typename Quirks> void _cycle_reference();
+    bool _stopped() const { return m_idle || m_halted || m_exited || m_fault != rem8Fault::None || (m_drawn && m_stop_on_draw); }
+
+    static Operands _decode(uint8_t msb, uint8_t lsb);
+    static uint16_t _dispatch_key(uint8_t msb, uint8_t lsb);
+    DecodedInstr _predecode(uint16_t addr) const;
+    uint8_t _fuse(uint8_t opcode, uint32_t next) const;
+    const DecodedInstr& _decode_at(uint16_t addr);
+    Operands _fused_next();
+    void _invalidate_code(uint32_t addr, uint32_t size);
+    static bool _idle_loop(const uint8_t* memory, std::size_t size, uint16_t addr);
+    void _reset_idle();
+
+    uint32_t _vip_cycles(const DecodedInstr& instr) const;
+    uint32_t _vip_extra_cycles(uint8_t opcode, Operands op) const;
+
+    uint32_t _skip_idle(uint32_t left);
+    uint64_t _timer_ticks(uint64_t cycle) const;
+    uint64_t _tick_cycle(uint64_t tick) const;
+    uint64_t _timer_expiry(uint8_t value) const;
+    uint8_t _timer_value(uint64_t expiry) const;
+
+    uint8_t _random_byte();
+
+    bool _stack_push_pc();
     void _stack_pull_pc();
 
     void _sprite_set(uint16_t loc);
-    char _sprite_draw(uint8_t X, uint8_t Y, char height);
-
-    void _instr_0NNN();
-    void _instr_00E0();
-    void _instr_00EE();
-    void _instr_1NNN(uint8_t msb, uint8_t lsb);
-    void _instr_2NNN(uint8_t msb, uint8_t lsb);
-    void _instr_3XNN(uint8_t msb, uint8_t lsb);
-    void _instr_4XNN(uint8_t msb, uint8_t lsb);
-    void _instr_5XY0(uint8_t msb, uint8_t lsb);
-    void _instr_6XNN(uint8_t msb, uint8_t lsb);
-    void _instr_7XNN(uint8_t msb, uint8_t lsb);
-    void _instr_8XY0(uint8_t msb, uint8_t lsb);
-    void _instr_8XY1(uint8_t msb, uint8_t lsb);
-    void _instr_8XY2(uint8_t msb, uint8_t lsb);
-    void _instr_8XY3(uint8_t msb, uint8_t lsb);
-    void _instr_8XY4(uint8_t msb, uint8_t lsb);
-    void _instr_8XY5(uint8_t msb, uint8_t lsb);
-    void _instr_8XY6(uint8_t msb, uint8_t lsb);
-    void _instr_8XY7(uint8_t msb, uint8_t lsb);
-    void _instr_8XYE(uint8_t msb, uint8_t lsb);
-    void _instr_9XY0(uint8_t msb, uint8_t lsb);
-    void _instr_ANNN(uint8_t msb, uint8_t lsb);
-    void _instr_BNNN(uint8_t msb, uint8_t lsb);
-    void _instr_CXNN(uint8_t msb, uint8_t lsb);
-    void _instr_DXYN(uint8_t msb, uint8_t lsb);
-    void _instr_EX9E(uint8_t msb);
-    void _instr_EXA1(uint8_t msb);
-    void _instr_FX07(uint8_t msb);
-    void _instr_FX0A(uint8_t msb);
-    void _instr_FX15(uint8_t msb);
-    void _instr_FX18(uint8_t msb);
-    void _instr_FX1E(uint8_t msb);
-    void _instr_FX29(uint8_t msb);
-    void _instr_FX33(uint8_t msb);
-    void _instr_FX55(uint8_t msb);
-    void _instr_FX65(uint8_t msb);
+    template <typename Quirks> char _sprite_draw(uint8_t X, uint8_t Y, char height, char width);
+    static bool _sprite_blit(uint8_t* screen, uint64_t pixels);
+    template <typename Quirks> char _mega_sprite_draw(uint8_t X, uint8_t Y);
+    bool _mega_blit(uint8_t* screen, const uint8_t* sprite, std::size_t count, bool& changed);
+    void _palette_reset();
+    void _layer_fill();
+    uint32_t* _layer_row(std::size_t row);
+    const uint32_t* _layer_row(std::size_t row) const;
+    void _layer_scroll(int rows);
+    void _set_resolution(uint16_t width, uint16_t height);
+    void _scroll_rows(int rows);
+    void _scroll_columns(int columns);
+    template <typename Quirks> void _skip();
+
+    static const std::array<uint64_t, 0x100> s_sprite_pixels;
+
+    void _instr_invalid(Operands op);
+    void _instr_0NNN(Operands op);
+    template <typename Quirks> void _instr_0010(Operands op);
+    template <typename Quirks> void _instr_0011(Operands op);
+    template <typename Quirks> void _instr_01NN(Operands op);
+    template <typename Quirks> void _instr_02NN(Operands op);
+    template <typename Quirks> void _instr_03NN(Operands op);
+    template <typename Quirks> void _instr_04NN(Operands op);
+    template <typename Quirks> void _instr_05NN(Operands op);
+    template <typename Quirks> void _instr_080N(Operands op);
+    template <typename Quirks> void _instr_09NN(Operands op);
+    template <typename Quirks> void _instr_00BN(Operands op);
+    void _instr_00E0(Operands op);
+    void _instr_00EE(Operands op);
+    template <typename Quirks> void _instr_00CN(Operands op);
+    template <typename Quirks> void _instr_00DN(Operands op);
+    template <typename Quirks> void _instr_00FB(Operands op);
+    template <typename Quirks> void _instr_00FC(Operands op);
+    template <typename Quirks> void _instr_00FD(Operands op);
+    template <typename Quirks> void _instr_00FE(Operands op);
+    template <typename Quirks> void _instr_00FF(Operands op);
+    void _instr_1NNN(Operands op);
+    void _instr_2NNN(Operands op);
+    template <typename Quirks> void _instr_3XNN(Operands op);
+    template <typename Quirks> void _instr_4XNN(Operands op);
+    template <typename Quirks> void _instr_5XY0(Operands op);
+    template <typename Quirks> void _instr_5XY2(Operands op);
+    template <typename Quirks> void _instr_5XY3(Operands op);
+    void _instr_6XNN(Operands op);
+    void _instr_7XNN(Operands op);
+    void _instr_8XY0(Operands op);
+    template <typename Quirks> void _instr_8XY1(Operands op);
+    template <typename Quirks> void _instr_8XY2(Operands op);
+    template <typename Quirks> void _instr_8XY3(Operands op);
+    void _instr_8XY4(Operands op);
+    void _instr_8XY5(Operands op);
+    template <typename Quirks> void _instr_8XY6(Operands op);
+    void _instr_8XY7(Operands op);
+    template <typename Quirks> void _instr_8XYE(Operands op);
+    template <typename Quirks> void _instr_9XY0(Operands op);
+    void _instr_ANNN(Operands op);
+    template <typename Quirks> void _instr_BNNN(Operands op);
+    void _instr_CXNN(Operands op);
+    template <typename Quirks> void _instr_DXYN(Operands op);
+    template <typename Quirks> void _instr_EX9E(Operands op);
+    template <typename Quirks> void _instr_EXA1(Operands op);
+    template <typename Quirks> void _instr_F000(Operands op);
+    template <typename Quirks> void _instr_FN01(Operands op);
+    void _instr_FX07(Operands op);
+    void _instr_FX0A(Operands op);
+    void _instr_FX15(Operands op);
+    void _instr_FX18(Operands op);
+    void _instr_FX1E(Operands op);
+    void _instr_FX29(Operands op);
+    template <typename Quirks> void _instr_FX30(Operands op);
+    void _instr_FX33(Operands op);
+    template <typename Quirks> void _instr_FX55(Operands op);
+    template <typename Quirks> void _instr_FX65(Operands op);
+    template <typename Quirks> void _instr_FX75(Operands op);
+    template <typename Quirks> void _instr_FX85(Operands op);
+    template <typename Quirks> void _instr_ANNN_DXYN(Operands op);
+    template <typename Quirks> void _instr_7XNN_3XNN(Operands op);
+    template <typename Quirks> void _instr_7XNN_4XNN(Operands op);
+    void _instr_6XNN_6XNN(Operands op);
+    void _instr_1NNN_idle(Operands op);
+    void _instr_decode(Operands op);
 
 };
 
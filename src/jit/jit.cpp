@@ -0,0 +1,487 @@
+/*  @file   jit.cpp
+ *  @brief  x86-64 basic block recompiler for the rem8C++ core.
+ *  @author Ryan V. Ngo
+ */
+
+#include "jit.h"
+
+#include <algorithm>
+
+#include "x86_emitter.h"
+
+#if defined(__x86_64__) && defined(__unix__)
+#include <sys/mman.h>
+#define REM8JIT_SUPPORTED 1
+#else
+#define REM8JIT_SUPPORTED 0
+#endif
+
+
+#define JIT_CODE_CAPACITY     0x40000
+#define JIT_MAX_BLOCK_INSTRS  32
+#define JIT_MAX_BLOCK_BYTES   0x800
+
+#define INSTR_SIZE            2
+
+
+// Guest registers are given host registers in this order, the caller-saved
+// ones first so short blocks do not need to save anything. RAX is scratch,
+// RDI holds the rem8Cpp pointer and ESI the instruction budget for the whole
+// block.
+static const X86Reg s_host_pool[] = {
+  RCX, RDX, R8, R9, R10, R11, RBX, RBP, R12, R13, R14, R15
+};
+
+static const std::size_t s_host_pool_size = sizeof(s_host_pool) / sizeof(s_host_pool[0]);
+
+static bool _callee_saved(X86Reg reg) {
+  return reg == RBX || reg == RBP || reg >= R12;
+}
+
+static int32_t _offset_of(const rem8Cpp& emulator, const void* member) {
+  return static_cast<int32_t>(
+      reinterpret_cast<const uint8_t*>(member) - reinterpret_cast<const uint8_t*>(&emulator)
+  );
+}
+
+
+//---------------------------------------------------
+// rem8Jit
+//---------------------------------------------------
+
+rem8Jit::rem8Jit()
+  : m_code(nullptr),
+    m_code_capacity(0),
+    m_code_size(0),
+    m_exit_size(0),
+    m_blocks(),
+    m_translated(),
+    m_entries()
+{
+#if REM8JIT_SUPPORTED
+  void* code = mmap(nullptr, JIT_CODE_CAPACITY, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (code != MAP_FAILED) {
+    m_code = static_cast<uint8_t*>(code);
+    m_code_capacity = JIT_CODE_CAPACITY;
+
+    // The exit back to run() every untranslated address jumps to, it sits
+    // at the start of the buffer and survives flushes
+    X86Emitter x86{m_code, m_code_capacity};
+    x86.mov_r32_r32(RAX, RSI);
+    x86.ret();
+    m_exit_size = x86.size();
+    m_code_size = m_exit_size;
+    mprotect(m_code, m_code_capacity, PROT_READ | PROT_EXEC);
+  }
+#endif
+}
+
+rem8Jit::~rem8Jit() {
+#if REM8JIT_SUPPORTED
+  if (m_code) munmap(m_code, m_code_capacity);
+#endif
+}
+
+bool rem8Jit::valid() const {
+  return m_code != nullptr;
+}
+
+// Idle loops are closed by an interpreted 1NNN and FX0A is interpreted too.
+// Draws, and calls and returns that fault, go through the instruction's
+// handler and come back here, so checking after each block and interpreted
+// instruction is enough. Timer instructions are interpreted as well, blocks
+// only advance the cycle counter by the budget they used.
+uint32_t rem8Jit::run(rem8Cpp& emulator, uint32_t count) {
+  _fit(emulator);
+  while (count > 0) {
+    uint16_t pc = emulator.m_program_counter;
+    if (!valid() || pc >= m_blocks.size()) {
+      emulator.cycle();
+      count--;
+      if (emulator._stopped()) return count;
+      continue;
+    }
+
+    Block& block = m_blocks[pc];
+    if (!block.translated) block = _translate(emulator, pc);
+
+    if (block.code == nullptr || block.length > count) {
+      emulator.cycle();
+      count--;
+      if (emulator._stopped()) return count;
+      continue;
+    }
+
+    uint32_t left = block.code(&emulator, count);
+    emulator.m_cycle += count - left;
+    count = left;
+    if (emulator._stopped()) return count;
+  }
+  return 0;
+}
+
+void rem8Jit::invalidate(const rem8Cpp&, uint32_t addr, uint32_t size) {
+  std::size_t last = std::min<std::size_t>(std::size_t{addr} + size, m_translated.size());
+  for (std::size_t i = addr; i < last; i++) {
+    if (m_translated[i]) {
+      flush();
+      return;
+    }
+  }
+}
+
+bool rem8Jit::has_code(uint16_t addr) const {
+  return addr < m_blocks.size() && m_blocks[addr].code != nullptr;
+}
+
+void rem8Jit::flush() {
+  std::fill(m_blocks.begin(), m_blocks.end(), Block{nullptr, 0, false});
+  std::fill(m_translated.begin(), m_translated.end(), 0);
+  std::fill(m_entries.begin(), m_entries.end(), reinterpret_cast<BlockFn>(m_code));
+  m_code_size = m_exit_size;
+}
+
+
+// Private methods - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - //
+
+// A block that can't be translated is kept with no code like any other, the
+// bytes that decided it are marked as translated so a write there drops it.
+// A block that overflows the code buffer is emitted once more into an empty
+// one.
+rem8Jit::Block rem8Jit::_translate(const rem8Cpp& emulator, uint16_t addr) {
+  // Scan the block, stopping before anything the interpreter has to run
+  std::vector<Instr> instrs;
+  int host_of[0x10];
+  std::fill(host_of, host_of + 0x10, -1);
+  std::size_t host_count = 0;
+  bool terminated = false;
+
+  // A skip's target depends on whether F000 NNNN follows with long_addressing,
+  // so those are left to the interpreter
+  const bool long_addressing = rem8Cpp::_visit_quirks(emulator.m_quirks, [](auto quirks) { return decltype(quirks)::long_addressing; });
+
+  const uint8_t* memory = emulator._memory();
+  const uint32_t size = emulator.m_addr_mask + 1u;
+  uint32_t pc = addr;
+  uint32_t first_read = addr;
+  while (instrs.size() < JIT_MAX_BLOCK_INSTRS && !terminated) {
+    if (pc + 1u >= size) break;
+    uint8_t msb = memory[pc];
+    uint8_t lsb = memory[pc + 1];
+    Instr instr{rem8Cpp::s_opcode_table[rem8Cpp::_dispatch_key(msb, lsb)], rem8Cpp::_decode(msb, lsb)};
+
+    bool uses_X = false, uses_Y = false, uses_F = false, native = true;
+    switch (instr.opcode) {
+      case rem8Cpp::OP_INVALID: case rem8Cpp::OP_0NNN: case rem8Cpp::OP_ANNN:
+        break;
+      case rem8Cpp::OP_6XNN: case rem8Cpp::OP_7XNN: case rem8Cpp::OP_FX1E:
+        uses_X = true; break;
+      case rem8Cpp::OP_8XY0:
+        uses_X = uses_Y = true; break;
+      case rem8Cpp::OP_8XY1: case rem8Cpp::OP_8XY2: case rem8Cpp::OP_8XY3: case rem8Cpp::OP_8XY4:
+      case rem8Cpp::OP_8XY5: case rem8Cpp::OP_8XY6: case rem8Cpp::OP_8XY7: case rem8Cpp::OP_8XYE:
+        uses_X = uses_Y = uses_F = true; break;
+      case rem8Cpp::OP_1NNN:
+        // Whether the loop is idle depends on the body it closes
+        native = !rem8Cpp::_idle_loop(memory, size, pc);
+        first_read = std::min<uint32_t>(first_read, instr.op.NNN);
+        terminated = true; break;
+      case rem8Cpp::OP_2NNN: case rem8Cpp::OP_00EE: case rem8Cpp::OP_DXYN:
+        terminated = true; break;
+      case rem8Cpp::OP_3XNN: case rem8Cpp::OP_4XNN:
+        native = !long_addressing;
+        uses_X = true; terminated = true; break;
+      case rem8Cpp::OP_5XY0: case rem8Cpp::OP_9XY0:
+        native = !long_addressing;
+        uses_X = uses_Y = true; terminated = true; break;
+      default:
+        native = false; break;
+    }
+    if (!native) break;
+
+    {
+      std::size_t needed = host_count;
+      uint8_t regs[3] = {instr.op.X, instr.op.Y, 0x0F};
+      bool uses[3] = {uses_X, uses_Y, uses_F};
+      bool counted[0x10] = {};
+      for (int i = 0; i < 3; i++) {
+        if (uses[i] && host_of[regs[i]] < 0 && !counted[regs[i]]) {
+          counted[regs[i]] = true;
+          needed++;
+        }
+      }
+      if (needed > s_host_pool_size) break;
+      for (int i = 0; i < 3; i++) {
+        if (uses[i] && host_of[regs[i]] < 0) host_of[regs[i]] = host_count++;
+      }
+    }
+
+    instrs.push_back(instr);
+    pc += INSTR_SIZE;
+  }
+
+  BlockFn code = nullptr;
+  if (!instrs.empty()) {
+    if (m_code_capacity - m_code_size < JIT_MAX_BLOCK_BYTES) flush();
+    code = _emit(emulator, addr, instrs, host_of, host_count);
+    if (code == nullptr) {
+      flush();
+      code = _emit(emulator, addr, instrs, host_of, host_count);
+    }
+  }
+
+  uint32_t last = std::min<uint32_t>(std::max<uint32_t>(pc, addr + INSTR_SIZE), size);
+  std::fill(m_translated.begin() + first_read, m_translated.begin() + last, 1);
+  if (code == nullptr) return Block{nullptr, 1, true};
+  m_entries[addr] = code;
+  return Block{code, static_cast<uint16_t>(instrs.size()), true};
+}
+
+// Host code for instrs at the end of the code buffer, null when it doesn't
+// fit. Every exit with a known target jumps through that address's entry.
+rem8Jit::BlockFn rem8Jit::_emit(const rem8Cpp& emulator, uint16_t addr, const std::vector<Instr>& instrs,
+                                const int* host_of, std::size_t host_count) {
+#if REM8JIT_SUPPORTED
+  mprotect(m_code, m_code_capacity, PROT_READ | PROT_WRITE);
+#endif
+
+  uint8_t* entry = m_code + m_code_size;
+  X86Emitter x86{entry, m_code_capacity - m_code_size};
+
+  const int32_t V_off = _offset_of(emulator, emulator.m_data_registers);
+  const int32_t I_off = _offset_of(emulator, &emulator.m_I_register);
+  const int32_t PC_off = _offset_of(emulator, &emulator.m_program_counter);
+  const int32_t SP_off = _offset_of(emulator, &emulator.m_stack_pointer);
+  const int32_t stack_off = _offset_of(emulator, emulator.m_stack);
+  const uint32_t addr_mask = emulator.m_addr_mask;
+  const uint32_t length = static_cast<uint32_t>(instrs.size());
+
+  auto V = [&](uint8_t reg) { return s_host_pool[host_of[reg]]; };
+
+  // Blocks are flushed when the profile changes, so its quirks can be baked in
+  const bool vf_reset = rem8Cpp::_visit_quirks(emulator.m_quirks, [](auto quirks) { return decltype(quirks)::vf_reset; });
+  const bool shift_vy = rem8Cpp::_visit_quirks(emulator.m_quirks, [](auto quirks) { return decltype(quirks)::shift_vy; });
+
+  // Prologue, a block jumped to without the budget for all of it goes back
+  // to run(). Guest registers are loaded once and stay in host registers.
+  x86.alu_r32_imm32(ALU_CMP, RSI, length);
+  x86.jcc(COND_C, m_code);
+  x86.alu_r32_imm32(ALU_SUB, RSI, length);
+  for (std::size_t i = 0; i < host_count; i++) {
+    if (_callee_saved(s_host_pool[i])) x86.push(s_host_pool[i]);
+  }
+  for (uint8_t reg = 0; reg < 0x10; reg++) {
+    if (host_of[reg] >= 0) x86.mov_r8_m8(V(reg), RDI, V_off + reg);
+  }
+
+  // Write registers back and restore the host's, leaving every host register
+  // but RDI and RSI free. Does not touch flags.
+  auto emit_leave = [&]() {
+    for (uint8_t reg = 0; reg < 0x10; reg++) {
+      if (host_of[reg] >= 0) x86.mov_m8_r8(RDI, V_off + reg, V(reg));
+    }
+    for (std::size_t i = host_count; i-- > 0;) {
+      if (_callee_saved(s_host_pool[i])) x86.pop(s_host_pool[i]);
+    }
+  };
+  auto emit_return = [&]() {
+    x86.mov_r32_r32(RAX, RSI);
+    x86.ret();
+  };
+  // Continue at target through its entry, or in run() past the address
+  // space. Does not touch flags.
+  auto emit_chain = [&](uint32_t target) {
+    uint16_t next = static_cast<uint16_t>(target);
+    x86.mov_m16_imm16(RDI, PC_off, next);
+    if (next > addr_mask) return emit_return();
+    x86.mov_r64_imm64(RAX, reinterpret_cast<uintptr_t>(&m_entries[next]));
+    x86.jmp_m64(RAX, 0);
+  };
+  // Run instr through its handler, which returns to run() in its place
+  auto emit_handler = [&](const Instr& instr, uint32_t next_pc) {
+    x86.mov_m16_imm16(RDI, PC_off, static_cast<uint16_t>(next_pc));
+    x86.mov_r32_imm32(RDX, (uint32_t{instr.opcode} << 16) | instr.op.opcode);
+    x86.mov_r64_imm64(RAX, reinterpret_cast<uintptr_t>(&_call_handler));
+    x86.jmp_r64(RAX);
+  };
+  auto emit_skip_exit = [&](X86Cond skip_cond, uint32_t next_pc) {
+    emit_leave();
+    std::size_t skip = x86.jcc_forward(skip_cond);
+    emit_chain(next_pc);
+    x86.bind(skip);
+    emit_chain(next_pc + INSTR_SIZE);
+  };
+
+  uint32_t pc = addr;
+  bool exited = false;
+  for (const auto& instr : instrs) {
+    const auto& op = instr.op;
+    uint32_t next_pc = pc + INSTR_SIZE;
+    switch (instr.opcode) {
+      case rem8Cpp::OP_6XNN:
+        x86.mov_r8_imm8(V(op.X), op.NN); break;
+      case rem8Cpp::OP_7XNN:
+        x86.alu_r8_imm8(ALU_ADD, V(op.X), op.NN); break;
+      case rem8Cpp::OP_8XY0:
+        x86.mov_r8_r8(V(op.X), V(op.Y)); break;
+      case rem8Cpp::OP_8XY1:
+        x86.alu_r8_r8(ALU_OR, V(op.X), V(op.Y));
+        if (vf_reset) x86.mov_r8_imm8(V(0x0F), 0x00);
+        break;
+      case rem8Cpp::OP_8XY2:
+        x86.alu_r8_r8(ALU_AND, V(op.X), V(op.Y));
+        if (vf_reset) x86.mov_r8_imm8(V(0x0F), 0x00);
+        break;
+      case rem8Cpp::OP_8XY3:
+        x86.alu_r8_r8(ALU_XOR, V(op.X), V(op.Y));
+        if (vf_reset) x86.mov_r8_imm8(V(0x0F), 0x00);
+        break;
+      case rem8Cpp::OP_8XY4:
+        x86.alu_r8_r8(ALU_ADD, V(op.X), V(op.Y));
+        x86.setcc_r8(COND_C, RAX);
+        x86.mov_r8_r8(V(0x0F), RAX);
+        break;
+      case rem8Cpp::OP_8XY5:
+        x86.alu_r8_r8(ALU_SUB, V(op.X), V(op.Y));
+        x86.setcc_r8(COND_NC, RAX);
+        x86.mov_r8_r8(V(0x0F), RAX);
+        break;
+      case rem8Cpp::OP_8XY6:
+        x86.mov_r8_r8(RAX, V(shift_vy ? op.Y : op.X));
+        x86.shr1_r8(RAX);
+        x86.mov_r8_r8(V(op.X), RAX);
+        x86.setcc_r8(COND_C, RAX);
+        x86.mov_r8_r8(V(0x0F), RAX);
+        break;
+      case rem8Cpp::OP_8XY7:
+        // VF is computed against VY after VX is written, which only matters when X == Y
+        if (op.X == op.Y) {
+          x86.alu_r8_imm8(ALU_CMP, V(op.X), 0x00);
+          x86.setcc_r8(COND_Z, RAX);
+          x86.mov_r8_imm8(V(op.X), 0x00);
+        } else {
+          x86.mov_r8_r8(RAX, V(op.Y));
+          x86.alu_r8_r8(ALU_SUB, RAX, V(op.X));
+          x86.mov_r8_r8(V(op.X), RAX);
+          x86.setcc_r8(COND_NC, RAX);
+        }
+        x86.mov_r8_r8(V(0x0F), RAX);
+        break;
+      case rem8Cpp::OP_8XYE:
+        x86.mov_r8_r8(RAX, V(shift_vy ? op.Y : op.X));
+        x86.shl1_r8(RAX);
+        x86.mov_r8_r8(V(op.X), RAX);
+        x86.setcc_r8(COND_C, RAX);
+        x86.mov_r8_r8(V(0x0F), RAX);
+        break;
+      case rem8Cpp::OP_ANNN:
+        x86.mov_m32_imm32(RDI, I_off, op.NNN); break;
+      case rem8Cpp::OP_FX1E:
+        x86.movzx_r32_r8(RAX, V(op.X));
+        x86.add_m32_r32(RDI, I_off, RAX);
+        break;
+      case rem8Cpp::OP_1NNN:
+        emit_leave();
+        emit_chain(op.NNN);
+        exited = true;
+        break;
+      case rem8Cpp::OP_2NNN: {
+        // A full stack faults in the handler
+        emit_leave();
+        x86.movzx_r32_m16(RAX, RDI, SP_off);
+        x86.alu_r32_imm32(ALU_CMP, RAX, REM8CPP_STACK_SIZE);
+        std::size_t overflow = x86.jcc_forward(COND_NC);
+        x86.mov_m16_imm16_indexed(RDI, RAX, stack_off, static_cast<uint16_t>(next_pc));
+        x86.alu_r32_imm32(ALU_ADD, RAX, 1);
+        x86.mov_m16_r16(RDI, SP_off, RAX);
+        emit_chain(op.NNN);
+        x86.bind(overflow);
+        emit_handler(instr, next_pc);
+        exited = true;
+        break;
+      }
+      case rem8Cpp::OP_00EE: {
+        // An empty stack faults in the handler, the return address is only
+        // known at run time so its entry is looked up then
+        emit_leave();
+        x86.movzx_r32_m16(RAX, RDI, SP_off);
+        x86.alu_r32_imm32(ALU_SUB, RAX, 1);
+        std::size_t underflow = x86.jcc_forward(COND_C);
+        x86.mov_m16_r16(RDI, SP_off, RAX);
+        x86.movzx_r32_m16_indexed(RAX, RDI, RAX, stack_off);
+        x86.mov_m16_r16(RDI, PC_off, RAX);
+        x86.alu_r32_imm32(ALU_CMP, RAX, addr_mask);
+        std::size_t outside = x86.jcc_forward(COND_A);
+        x86.mov_r64_imm64(RCX, reinterpret_cast<uintptr_t>(m_entries.data()));
+        x86.jmp_m64_indexed(RCX, RAX);
+        x86.bind(outside);
+        emit_return();
+        x86.bind(underflow);
+        emit_handler(instr, next_pc);
+        exited = true;
+        break;
+      }
+      case rem8Cpp::OP_DXYN:
+        emit_leave();
+        emit_handler(instr, next_pc);
+        exited = true;
+        break;
+      case rem8Cpp::OP_3XNN:
+        x86.alu_r8_imm8(ALU_CMP, V(op.X), op.NN);
+        emit_skip_exit(COND_Z, next_pc);
+        exited = true;
+        break;
+      case rem8Cpp::OP_4XNN:
+        x86.alu_r8_imm8(ALU_CMP, V(op.X), op.NN);
+        emit_skip_exit(COND_NZ, next_pc);
+        exited = true;
+        break;
+      case rem8Cpp::OP_5XY0:
+        x86.alu_r8_r8(ALU_CMP, V(op.X), V(op.Y));
+        emit_skip_exit(COND_Z, next_pc);
+        exited = true;
+        break;
+      case rem8Cpp::OP_9XY0:
+        x86.alu_r8_r8(ALU_CMP, V(op.X), V(op.Y));
+        emit_skip_exit(COND_NZ, next_pc);
+        exited = true;
+        break;
+      default:
+        break;
+    }
+    pc = next_pc;
+  }
+
+  if (!exited) {
+    emit_leave();
+    emit_chain(pc);
+  }
+
+#if REM8JIT_SUPPORTED
+  mprotect(m_code, m_code_capacity, PROT_READ | PROT_EXEC);
+#endif
+
+  if (x86.overflowed()) return nullptr;
+
+  m_code_size += x86.size();
+  return reinterpret_cast<BlockFn>(entry);
+}
+
+// Runs the instruction a block ends with through the profile's handler, the
+// program counter already points past it
+uint32_t rem8Jit::_call_handler(rem8Cpp* emulator, uint32_t count, uint32_t instr) {
+  uint8_t opcode = static_cast<uint8_t>(instr >> 16);
+  emulator->m_handlers[opcode](*emulator, rem8Cpp::_decode((instr >> 8) & 0xFF, instr & 0xFF));
+  return count;
+}
+
+// Size the tables to the profile's address space, code built for another
+// one holds entry addresses of the old tables and is dropped
+void rem8Jit::_fit(const rem8Cpp& emulator) {
+  std::size_t size = emulator.m_addr_mask + 1u;
+  if (m_blocks.size() == size) return;
+  m_blocks.resize(size);
+  m_translated.resize(size);
+  m_entries.resize(size);
+  flush();
+}
@@ -0,0 +1,70 @@
+/*  @file   jit.h
+ *  @brief  x86-64 basic block recompiler for the rem8C++ core.
+ *  @author Ryan V. Ngo
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "emulator.h"
+
+
+//---------------------------------------------------
+// rem8Jit
+//---------------------------------------------------
+
+class rem8Jit : public rem8Backend {
+  public:
+    rem8Jit();
+    ~rem8Jit() override;
+
+    bool valid() const;
+    uint32_t run(rem8Cpp& emulator, uint32_t count) override;
+    void invalidate(const rem8Cpp& emulator, uint32_t addr, uint32_t size) override;
+    void flush();
+    bool has_code(uint16_t addr) const;
+
+    rem8Jit(const rem8Jit& other) = delete;
+    rem8Jit(rem8Jit&& other) = delete;
+    rem8Jit& operator=(const rem8Jit& other) = delete;
+    rem8Jit& operator=(rem8Jit&& other) = delete;
+
+  private:
+    // Takes the instruction budget and returns what is left of it, blocks
+    // jump straight into the next one while the budget lasts
+    using BlockFn = uint32_t (*)(rem8Cpp* emulator, uint32_t count);
+
+    // A block with no code is run one instruction at a time by the interpreter
+    struct Block {
+      BlockFn code;
+      uint16_t length;
+      bool translated;
+    };
+
+    struct Instr {
+      uint8_t opcode;
+      rem8Cpp::Operands op;
+    };
+
+    uint8_t* m_code;
+    std::size_t m_code_capacity;
+    std::size_t m_code_size;
+    std::size_t m_exit_size;
+
+    // Indexed by guest address, m_entries holds the code a block jumps to
+    // for each one, the exit back to run() until a block is translated there
+    std::vector<Block> m_blocks;
+    std::vector<uint8_t> m_translated;
+    std::vector<BlockFn> m_entries;
+
+    Block _translate(const rem8Cpp& emulator, uint16_t addr);
+    BlockFn _emit(const rem8Cpp& emulator, uint16_t addr, const std::vector<Instr>& instrs,
+                  const int* host_of, std::size_t host_count);
+    void _fit(const rem8Cpp& emulator);
+    static uint32_t _call_handler(rem8Cpp* emulator, uint32_t count, uint32_t instr);
+
+};
+
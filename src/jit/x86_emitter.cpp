@@ -0,0 +1,277 @@
+/*  @file   x86_emitter.cpp
+ *  @brief  Minimal x86-64 machine code emitter used by the rem8C++ JIT.
+ *  @author Ryan V. Ngo
+ */
+
+#include "x86_emitter.h"
+
+
+//---------------------------------------------------
+// X86Emitter
+//---------------------------------------------------
+
+X86Emitter::X86Emitter(uint8_t* buffer, std::size_t capacity)
+  : m_buffer(buffer),
+    m_capacity(capacity),
+    m_size(0),
+    m_overflowed(false)
+{ }
+
+std::size_t X86Emitter::size() const {
+  return m_size;
+}
+
+bool X86Emitter::overflowed() const {
+  return m_overflowed;
+}
+
+void X86Emitter::push(X86Reg reg) {
+  if (reg >= R8) _byte(0x41);
+  _byte(0x50 | (reg & 0x07));
+}
+
+void X86Emitter::pop(X86Reg reg) {
+  if (reg >= R8) _byte(0x41);
+  _byte(0x58 | (reg & 0x07));
+}
+
+void X86Emitter::ret() {
+  _byte(0xC3);
+}
+
+void X86Emitter::mov_r8_imm8(X86Reg dst, uint8_t imm) {
+  _rex(false, 0, dst, false, true);
+  _byte(0xB0 | (dst & 0x07));
+  _byte(imm);
+}
+
+void X86Emitter::mov_r8_r8(X86Reg dst, X86Reg src) {
+  _rex(false, src, dst, true, true);
+  _byte(0x88);
+  _modrm_reg(src, dst);
+}
+
+void X86Emitter::alu_r8_r8(X86Alu op, X86Reg dst, X86Reg src) {
+  _rex(false, src, dst, true, true);
+  _byte(op << 3);
+  _modrm_reg(src, dst);
+}
+
+void X86Emitter::alu_r8_imm8(X86Alu op, X86Reg dst, uint8_t imm) {
+  _rex(false, 0, dst, false, true);
+  _byte(0x80);
+  _modrm_reg(op, dst);
+  _byte(imm);
+}
+
+void X86Emitter::shr1_r8(X86Reg reg) {
+  _rex(false, 0, reg, false, true);
+  _byte(0xD0);
+  _modrm_reg(5, reg);
+}
+
+void X86Emitter::shl1_r8(X86Reg reg) {
+  _rex(false, 0, reg, false, true);
+  _byte(0xD0);
+  _modrm_reg(4, reg);
+}
+
+void X86Emitter::setcc_r8(X86Cond cond, X86Reg dst) {
+  _rex(false, 0, dst, false, true);
+  _byte(0x0F);
+  _byte(0x90 | cond);
+  _modrm_reg(0, dst);
+}
+
+void X86Emitter::mov_r8_m8(X86Reg dst, X86Reg base, int32_t disp) {
+  _rex(false, dst, base, true, false);
+  _byte(0x8A);
+  _modrm_disp32(dst, base, disp);
+}
+
+void X86Emitter::mov_m8_r8(X86Reg base, int32_t disp, X86Reg src) {
+  _rex(false, src, base, true, false);
+  _byte(0x88);
+  _modrm_disp32(src, base, disp);
+}
+
+void X86Emitter::mov_m16_imm16(X86Reg base, int32_t disp, uint16_t imm) {
+  _byte(0x66);
+  _rex(false, 0, base, false, false);
+  _byte(0xC7);
+  _modrm_disp32(0, base, disp);
+  _imm16(imm);
+}
+
+void X86Emitter::mov_m16_r16(X86Reg base, int32_t disp, X86Reg src) {
+  _byte(0x66);
+  _rex(false, src, base, false, false);
+  _byte(0x89);
+  _modrm_disp32(src, base, disp);
+}
+
+void X86Emitter::mov_m32_imm32(X86Reg base, int32_t disp, uint32_t imm) {
+  _rex(false, 0, base, false, false);
+  _byte(0xC7);
+  _modrm_disp32(0, base, disp);
+  _imm32(imm);
+}
+
+void X86Emitter::add_m32_r32(X86Reg base, int32_t disp, X86Reg src) {
+  _rex(false, src, base, false, false);
+  _byte(0x01);
+  _modrm_disp32(src, base, disp);
+}
+
+void X86Emitter::movzx_r32_r8(X86Reg dst, X86Reg src) {
+  _rex(false, dst, src, false, true);
+  _byte(0x0F);
+  _byte(0xB6);
+  _modrm_reg(dst, src);
+}
+
+void X86Emitter::movzx_r32_m16(X86Reg dst, X86Reg base, int32_t disp) {
+  _rex(false, dst, base, false, false);
+  _byte(0x0F);
+  _byte(0xB7);
+  _modrm_disp32(dst, base, disp);
+}
+
+void X86Emitter::mov_r32_r32(X86Reg dst, X86Reg src) {
+  _rex(false, src, dst, false, false);
+  _byte(0x89);
+  _modrm_reg(src, dst);
+}
+
+void X86Emitter::mov_r32_imm32(X86Reg dst, uint32_t imm) {
+  _rex(false, 0, dst, false, false);
+  _byte(0xB8 | (dst & 0x07));
+  _imm32(imm);
+}
+
+void X86Emitter::mov_r64_imm64(X86Reg dst, uint64_t imm) {
+  _rex(true, 0, dst, false, false);
+  _byte(0xB8 | (dst & 0x07));
+  _imm32(static_cast<uint32_t>(imm));
+  _imm32(static_cast<uint32_t>(imm >> 32));
+}
+
+void X86Emitter::alu_r32_imm32(X86Alu op, X86Reg dst, uint32_t imm) {
+  _rex(false, 0, dst, false, false);
+  _byte(0x81);
+  _modrm_reg(op, dst);
+  _imm32(imm);
+}
+
+void X86Emitter::movzx_r32_m16_indexed(X86Reg dst, X86Reg base, X86Reg index, int32_t disp) {
+  _rex_indexed(dst, base, index);
+  _byte(0x0F);
+  _byte(0xB7);
+  _modrm_indexed(dst, base, index, 1, disp);
+}
+
+void X86Emitter::mov_m16_imm16_indexed(X86Reg base, X86Reg index, int32_t disp, uint16_t imm) {
+  _byte(0x66);
+  _rex_indexed(0, base, index);
+  _byte(0xC7);
+  _modrm_indexed(0, base, index, 1, disp);
+  _imm16(imm);
+}
+
+void X86Emitter::jmp_r64(X86Reg reg) {
+  _rex(false, 0, reg, false, false);
+  _byte(0xFF);
+  _modrm_reg(4, reg);
+}
+
+void X86Emitter::jmp_m64(X86Reg base, int32_t disp) {
+  _rex(false, 0, base, false, false);
+  _byte(0xFF);
+  _modrm_disp32(4, base, disp);
+}
+
+void X86Emitter::jmp_m64_indexed(X86Reg base, X86Reg index) {
+  _rex_indexed(0, base, index);
+  _byte(0xFF);
+  _modrm_indexed(4, base, index, 3, 0);
+}
+
+void X86Emitter::jcc(X86Cond cond, const uint8_t* target) {
+  _byte(0x0F);
+  _byte(0x80 | cond);
+  _imm32(static_cast<uint32_t>(target - (m_buffer + m_size + 4)));
+}
+
+std::size_t X86Emitter::jcc_forward(X86Cond cond) {
+  _byte(0x0F);
+  _byte(0x80 | cond);
+  std::size_t label = m_size;
+  _imm32(0);
+  return label;
+}
+
+void X86Emitter::bind(std::size_t label) {
+  if (m_overflowed) return;
+  uint32_t rel = static_cast<uint32_t>(m_size - (label + 4));
+  for (int i = 0; i < 4; i++) {
+    m_buffer[label + i] = (rel >> (i * 8)) & 0xFF;
+  }
+}
+
+
+// Private methods - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - //
+
+void X86Emitter::_byte(uint8_t byte) {
+  if (m_size >= m_capacity) {
+    m_overflowed = true;
+    return;
+  }
+  m_buffer[m_size++] = byte;
+}
+
+void X86Emitter::_imm16(uint16_t imm) {
+  _byte(imm & 0xFF);
+  _byte((imm >> 8) & 0xFF);
+}
+
+void X86Emitter::_imm32(uint32_t imm) {
+  for (int i = 0; i < 4; i++) {
+    _byte((imm >> (i * 8)) & 0xFF);
+  }
+}
+
+// Emit a REX prefix when one is needed. Byte operands on registers 4 - 7 need
+// an empty REX to mean spl/bpl/sil/dil instead of ah/ch/dh/bh.
+void X86Emitter::_rex(bool W, uint8_t reg, uint8_t rm, bool reg_byte, bool rm_byte) {
+  uint8_t rex = 0x40;
+  if (W) rex |= 0x08;
+  if (reg >= R8) rex |= 0x04;
+  if (rm >= R8) rex |= 0x01;
+  bool uniform_byte = (reg_byte && reg >= RSP && reg <= RDI) || (rm_byte && rm >= RSP && rm <= RDI);
+  if (rex != 0x40 || uniform_byte) _byte(rex);
+}
+
+void X86Emitter::_rex_indexed(uint8_t reg, X86Reg base, X86Reg index) {
+  uint8_t rex = 0x40;
+  if (reg >= R8) rex |= 0x04;
+  if (index >= R8) rex |= 0x02;
+  if (base >= R8) rex |= 0x01;
+  if (rex != 0x40) _byte(rex);
+}
+
+void X86Emitter::_modrm_reg(uint8_t reg, uint8_t rm) {
+  _byte(0xC0 | ((reg & 0x07) << 3) | (rm & 0x07));
+}
+
+void X86Emitter::_modrm_disp32(uint8_t reg, X86Reg base, int32_t disp) {
+  _byte(0x80 | ((reg & 0x07) << 3) | (base & 0x07));
+  if ((base & 0x07) == RSP) _byte(0x24);
+  _imm32(static_cast<uint32_t>(disp));
+}
+
+// [base + index << scale + disp32] through a SIB byte, index can't be RSP
+void X86Emitter::_modrm_indexed(uint8_t reg, X86Reg base, X86Reg index, uint8_t scale, int32_t disp) {
+  _byte(0x84 | ((reg & 0x07) << 3));
+  _byte((scale << 6) | ((index & 0x07) << 3) | (base & 0x07));
+  _imm32(static_cast<uint32_t>(disp));
+}
@@ -0,0 +1,99 @@
+/*  @file   x86_emitter.h
+ *  @brief  Minimal x86-64 machine code emitter used by the rem8C++ JIT.
+ *  @author Ryan V. Ngo
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+
+// Host register numbers as encoded in ModRM/REX
+enum X86Reg : uint8_t {
+  RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RBP = 5, RSI = 6, RDI = 7,
+  R8 = 8, R9 = 9, R10 = 10, R11 = 11, R12 = 12, R13 = 13, R14 = 14, R15 = 15
+};
+
+// Group 1 ALU operations, the value is the /digit of the imm8 form and
+// (value << 3) is the opcode of the r/m8, r8 form
+enum X86Alu : uint8_t {
+  ALU_ADD = 0, ALU_OR = 1, ALU_AND = 4, ALU_SUB = 5, ALU_XOR = 6, ALU_CMP = 7
+};
+
+// Condition codes for SETcc/Jcc
+enum X86Cond : uint8_t {
+  COND_C = 0x2, COND_NC = 0x3, COND_Z = 0x4, COND_NZ = 0x5, COND_A = 0x7
+};
+
+
+//---------------------------------------------------
+// X86Emitter
+//---------------------------------------------------
+
+class X86Emitter {
+  public:
+    X86Emitter(uint8_t* buffer, std::size_t capacity);
+
+    std::size_t size() const;
+    bool overflowed() const;
+
+    void push(X86Reg reg);
+    void pop(X86Reg reg);
+    void ret();
+
+    // 8-bit register forms, values live in the low byte of each register
+    void mov_r8_imm8(X86Reg dst, uint8_t imm);
+    void mov_r8_r8(X86Reg dst, X86Reg src);
+    void alu_r8_r8(X86Alu op, X86Reg dst, X86Reg src);
+    void alu_r8_imm8(X86Alu op, X86Reg dst, uint8_t imm);
+    void shr1_r8(X86Reg reg);
+    void shl1_r8(X86Reg reg);
+    void setcc_r8(X86Cond cond, X86Reg dst);
+
+    // Memory operands are always [base + disp32]
+    void mov_r8_m8(X86Reg dst, X86Reg base, int32_t disp);
+    void mov_m8_r8(X86Reg base, int32_t disp, X86Reg src);
+    void mov_m16_imm16(X86Reg base, int32_t disp, uint16_t imm);
+    void mov_m16_r16(X86Reg base, int32_t disp, X86Reg src);
+    void mov_m32_imm32(X86Reg base, int32_t disp, uint32_t imm);
+    void add_m32_r32(X86Reg base, int32_t disp, X86Reg src);
+
+    void movzx_r32_r8(X86Reg dst, X86Reg src);
+    void movzx_r32_m16(X86Reg dst, X86Reg base, int32_t disp);
+    void mov_r32_r32(X86Reg dst, X86Reg src);
+    void mov_r32_imm32(X86Reg dst, uint32_t imm);
+    void mov_r64_imm64(X86Reg dst, uint64_t imm);
+    void alu_r32_imm32(X86Alu op, X86Reg dst, uint32_t imm);
+
+    // Indexed memory operands are [base + index * 2 + disp32] for words and
+    // [base + index * 8] for code pointers
+    void movzx_r32_m16_indexed(X86Reg dst, X86Reg base, X86Reg index, int32_t disp);
+    void mov_m16_imm16_indexed(X86Reg base, X86Reg index, int32_t disp, uint16_t imm);
+
+    // Jumps, a forward Jcc returns a label that bind() points at the current
+    // position
+    void jmp_r64(X86Reg reg);
+    void jmp_m64(X86Reg base, int32_t disp);
+    void jmp_m64_indexed(X86Reg base, X86Reg index);
+    void jcc(X86Cond cond, const uint8_t* target);
+    std::size_t jcc_forward(X86Cond cond);
+    void bind(std::size_t label);
+
+  private:
+    uint8_t* m_buffer;
+    std::size_t m_capacity;
+    std::size_t m_size;
+    bool m_overflowed;
+
+    void _byte(uint8_t byte);
+    void _imm16(uint16_t imm);
+    void _imm32(uint32_t imm);
+    void _rex(bool W, uint8_t reg, uint8_t rm, bool reg_byte, bool rm_byte);
+    void _rex_indexed(uint8_t reg, X86Reg base, X86Reg index);
+    void _modrm_reg(uint8_t reg, uint8_t rm);
+    void _modrm_disp32(uint8_t reg, X86Reg base, int32_t disp);
+    void _modrm_indexed(uint8_t reg, X86Reg base, X86Reg index, uint8_t scale, int32_t disp);
+
+};
+
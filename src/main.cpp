@@ -16,6 +16,24 @@
 #include "utilities/file.h"
 
 
+// Host key driving each key of the hex keypad
+struct KeyBind {
+  int glfw_key;
+  uint8_t key;
+};
+
+static const KeyBind key_binds[] = {
+  {GLFW_KEY_1, 0x1}, {GLFW_KEY_2, 0x2}, {GLFW_KEY_3, 0x3}, {GLFW_KEY_4, 0xC},
+  {GLFW_KEY_Q, 0x4}, {GLFW_KEY_W, 0x5}, {GLFW_KEY_E, 0x6}, {GLFW_KEY_R, 0xD},
+  {GLFW_KEY_A, 0x7}, {GLFW_KEY_S, 0x8}, {GLFW_KEY_D, 0x9}, {GLFW_KEY_F, 0xE},
+  {GLFW_KEY_Z, 0xA}, {GLFW_KEY_X, 0x0}, {GLFW_KEY_C, 0xB}, {GLFW_KEY_V, 0xF},
+};
+
+// Longest wait for input when a frame has nothing new to show, vsync no
+// longer paces the loop then
+static constexpr double IDLE_FRAME_SECONDS = 1.0 / 60;
+
+
 int main() {
   if (!glfwInit()) {
     std::cerr << "Failed to initialize GLFW" << std::endl;
@@ -32,6 +50,19 @@ int main() {
   app_window.make_current_context();
   app_window.set_vsync(true);
 
+  if (glewInit() != GLEW_OK) {
+    std::cerr << "Failed to initialize GLEW" << std::endl;
+    glfwTerminate();
+    return -1;
+  }
+
+  // Screen bytes are coloured on the GPU through the emulator's palette
+  PaletteShader palette_shader;
+  if (!palette_shader.valid()) {
+    glfwTerminate();
+    return -1;
+  }
+
   WidgetRunner widget_runner{app_window.window()};
 
   auto emulator = rem8Cpp();
@@ -41,60 +72,96 @@ int main() {
 
   size_t screen_width = emulator.width();
   size_t screen_height = emulator.height();
-  Texture screen_texture{screen_width, screen_height};
-  std::vector<unsigned char> screen_buffer(screen_width * screen_height * 3);
+  Texture screen_texture{screen_width, screen_height, TextureFormat::Index};
+  Texture palette_texture{0x100, 1};
+  palette_texture.update(0, 0, 0x100, 1, reinterpret_cast<const uint8_t*>(emulator.palette()));
+
+  // MEGA-CHIP mode blends colours on the emulator's side, its screen is
+  // uploaded as RGBA instead
+  Texture mega_texture{REM8CPP_MEGA_WIDTH, REM8CPP_MEGA_HEIGHT};
+  std::vector<unsigned char> mega_rgba(REM8CPP_MEGA_WIDTH * REM8CPP_MEGA_HEIGHT * 4);
+
+  // What the last presented frame showed
+  uint64_t shown_generation = emulator.frame_generation();
+  std::size_t shown_width = 0;
+  std::size_t shown_height = 0;
 
   // Main loop
   double last_time = 0;
-  double delay_accumulator = 0;
+  double cycle_accumulator = 0;
   while (!app_window.should_close()) {
     glfwPollEvents();
-    app_window.is_key_pressed(GLFW_KEY_1) ? emulator.set_key('1') : emulator.unset_key('1'); 
-    app_window.is_key_pressed(GLFW_KEY_2) ? emulator.set_key('2') : emulator.unset_key('2');
-    app_window.is_key_pressed(GLFW_KEY_3) ? emulator.set_key('3') : emulator.unset_key('3');
-    app_window.is_key_pressed(GLFW_KEY_4) ? emulator.set_key('4') : emulator.unset_key('4');
-    app_window.is_key_pressed(GLFW_KEY_Q) ? emulator.set_key('q') : emulator.unset_key('q');
-    app_window.is_key_pressed(GLFW_KEY_W) ? emulator.set_key('w') : emulator.unset_key('w');
-    app_window.is_key_pressed(GLFW_KEY_E) ? emulator.set_key('e') : emulator.unset_key('e');
-    app_window.is_key_pressed(GLFW_KEY_R) ? emulator.set_key('r') : emulator.unset_key('r');
-    app_window.is_key_pressed(GLFW_KEY_A) ? emulator.set_key('a') : emulator.unset_key('a');
-    app_window.is_key_pressed(GLFW_KEY_S) ? emulator.set_key('s') : emulator.unset_key('s');
-    app_window.is_key_pressed(GLFW_KEY_D) ? emulator.set_key('d') : emulator.unset_key('d');
-    app_window.is_key_pressed(GLFW_KEY_F) ? emulator.set_key('f') : emulator.unset_key('f');
-    app_window.is_key_pressed(GLFW_KEY_Z) ? emulator.set_key('z') : emulator.unset_key('z');
-    app_window.is_key_pressed(GLFW_KEY_X) ? emulator.set_key('x') : emulator.unset_key('x');
-    app_window.is_key_pressed(GLFW_KEY_C) ? emulator.set_key('c') : emulator.unset_key('c');
-    app_window.is_key_pressed(GLFW_KEY_V) ? emulator.set_key('v') : emulator.unset_key('v');
+    for (const auto& bind : key_binds) {
+      app_window.is_key_pressed(bind.glfw_key) ? emulator.set_key(bind.key) : emulator.unset_key(bind.key);
+    }
 
     // Emulator cycling
     double curr_time = glfwGetTime() * 1000;
     if (!control_panel.pause()) {
       double elapsed_time = curr_time - last_time;
 
-      delay_accumulator += elapsed_time;
-      if (delay_accumulator >= 16.667) {
-        emulator.update_timers();
-        delay_accumulator = 0.0;
-      }
-
-      uint32_t cycle_count = elapsed_time / (1000.0f / control_panel.clock_rate());
-      for (uint32_t i = 0; i < cycle_count; i++) {
-        emulator.cycle();
+      // Timers are derived from the emulator's cycle count at its clock rate.
+      // VIP timing keeps the VIP's rate and holds on to this one for later.
+      emulator.set_clock_rate(control_panel.clock_rate());
+      cycle_accumulator += elapsed_time * emulator.clock_rate() / 1000.0;
+      uint32_t cycle_count = cycle_accumulator;
+      cycle_accumulator -= cycle_count;
+      while (cycle_count > 0) {
+        rem8RunResult result = emulator.run_batch(cycle_count);
+        cycle_count -= result.cycles;
+        if (result.event == rem8Event::Fault || result.event == rem8Event::Exit) break;
       }
     }
     last_time = curr_time;
 
-    emulator.get_screen_rgb(screen_buffer);
-    screen_texture.update(0, 0, screen_width, screen_height, screen_buffer.data());
+    // SCHIP programs switch resolution at any time
+    if (emulator.width() != screen_width || emulator.height() != screen_height) {
+      screen_width = emulator.width();
+      screen_height = emulator.height();
+      screen_texture.resize(screen_width, screen_height);
+    }
 
+    // Static screens are common, frames are only drawn and presented when the
+    // screen, the UI or the window size changed since the last one shown
+    bool ui_changed = widget_runner.update();
     std::size_t win_width{};
     std::size_t win_height{};
     app_window.frame_buff_size(win_width, win_height);
-    update_viewport(win_width, win_height);
-
-    clear();
-    draw_texture(screen_texture);
-    widget_runner.render();
+    bool present = ui_changed || emulator.frame_generation() != shown_generation ||
+                   win_width != shown_width || win_height != shown_height;
+
+    if (present) {
+      // Only runs of rows drawn since the last frame are uploaded, the palette
+      // with any new frame since recolouring doesn't touch the screen
+      if (emulator.frame_generation() != shown_generation) {
+        palette_texture.update(0, 0, 0x100, 1, reinterpret_cast<const uint8_t*>(emulator.palette()));
+      }
+      const rem8DirtyRows& dirty = emulator.dirty_rows();
+      for (std::size_t row = 0; row < screen_height;) {
+        if (!dirty[row]) {
+          row++;
+          continue;
+        }
+        std::size_t first = row;
+        while (row < screen_height && dirty[row]) row++;
+        if (emulator.megachip()) {
+          emulator.get_screen_rgba(mega_rgba, first, row - first);
+          mega_texture.update(0, first, screen_width, row - first, mega_rgba.data() + 4 * first * screen_width);
+        } else {
+          screen_texture.update(0, first, screen_width, row - first, emulator.get_screen().data() + first * screen_width);
+        }
+      }
+      emulator.clear_dirty_rows();
+      shown_generation = emulator.frame_generation();
+      shown_width = win_width;
+      shown_height = win_height;
+
+      update_viewport(win_width, win_height);
+      clear();
+      if (emulator.megachip()) draw_texture(mega_texture);
+      else draw_indexed(screen_texture, palette_texture, palette_shader);
+      widget_runner.render();
+    }
 
     if (control_panel.reload()) {
       auto rom_path = control_panel.get_selected_rom();
@@ -104,12 +171,15 @@ int main() {
       auto load_addr = control_panel.load_addr();
 
       emulator.set_program_counter(start_addr);
-      emulator.load_rom(load_addr, rom_data, rom_data.size());
+      if (!emulator.load_rom(load_addr, rom_data, rom_data.size())) {
+        std::cerr << "ROM does not fit in memory: " << rom_path << std::endl;
+      }
 
       control_panel.unset_reload();
     }
 
-    app_window.swap_buffers();
+    if (present) app_window.swap_buffers();
+    else glfwWaitEventsTimeout(IDLE_FRAME_SECONDS);
   }
 
   glfwTerminate();
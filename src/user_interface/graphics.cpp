@@ -6,34 +6,42 @@
 
 #include <GLFW/glfw3.h>
 
+#include <iostream>
+
 
 //---------------------------------------------------
 // Texture
 //---------------------------------------------------
 
-Texture::Texture(std::size_t width, std::size_t height) {
+Texture::Texture(std::size_t width, std::size_t height, TextureFormat format) : m_format(format) {
   glGenTextures(1, &m_id);
   glBindTexture(GL_TEXTURE_2D, m_id);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  resize(width, height);
+}
+
+Texture::~Texture() {
+  glDeleteTextures(1, &m_id);
+}
+
+void Texture::resize(std::size_t width, std::size_t height) {
+  glBindTexture(GL_TEXTURE_2D, m_id);
   glTexImage2D(
       GL_TEXTURE_2D, 
       0, 
-      GL_RGB32F,
+      m_format == TextureFormat::Index ? GL_R8 : GL_RGBA8,
       width, 
       height, 
       0, 
-      GL_RGB, 
+      m_format == TextureFormat::Index ? GL_RED : GL_RGBA, 
       GL_UNSIGNED_BYTE, 
       nullptr
   ); 
   glBindTexture(GL_TEXTURE_2D, 0);
 }
 
-Texture::~Texture() {
-  glDeleteTextures(1, &m_id);
-}
-
 void Texture::update(
     std::size_t x_offset,
     std::size_t y_offset,
@@ -47,7 +55,7 @@ void Texture::update(
       0, 
       x_offset, y_offset,
       width, height,
-      GL_RGB,
+      m_format == TextureFormat::Index ? GL_RED : GL_RGBA,
       GL_UNSIGNED_BYTE,
       data
   );
@@ -63,6 +71,93 @@ void Texture::unbind() const {
 }
 
 
+//---------------------------------------------------
+// PaletteShader
+//---------------------------------------------------
+
+static const char* s_palette_vertex_source = R"(#version 130
+out vec2 uv;
+void main() {
+  uv = gl_MultiTexCoord0.xy;
+  gl_Position = gl_Vertex;
+}
+)";
+
+// The index texture sits on unit 0 and the palette on unit 1
+static const char* s_palette_fragment_source = R"(#version 130
+uniform sampler2D screen;
+uniform sampler2D palette;
+in vec2 uv;
+void main() {
+  int index = int(texture(screen, uv).r * 255.0 + 0.5);
+  gl_FragColor = texelFetch(palette, ivec2(index, 0), 0);
+}
+)";
+
+static GLuint compile_shader(GLenum type, const char* source) {
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &source, nullptr);
+  glCompileShader(shader);
+
+  GLint status{};
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+  if (!status) {
+    char log[512];
+    glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+    std::cerr << "Failed to compile shader: " << log << std::endl;
+    glDeleteShader(shader);
+    return 0;
+  }
+  return shader;
+}
+
+PaletteShader::PaletteShader() {
+  GLuint vertex = compile_shader(GL_VERTEX_SHADER, s_palette_vertex_source);
+  GLuint fragment = compile_shader(GL_FRAGMENT_SHADER, s_palette_fragment_source);
+  if (vertex && fragment) {
+    m_program = glCreateProgram();
+    glAttachShader(m_program, vertex);
+    glAttachShader(m_program, fragment);
+    glLinkProgram(m_program);
+
+    GLint status{};
+    glGetProgramiv(m_program, GL_LINK_STATUS, &status);
+    if (!status) {
+      char log[512];
+      glGetProgramInfoLog(m_program, sizeof(log), nullptr, log);
+      std::cerr << "Failed to link shader program: " << log << std::endl;
+      glDeleteProgram(m_program);
+      m_program = 0;
+    }
+  }
+  glDeleteShader(vertex);
+  glDeleteShader(fragment);
+
+  if (m_program) {
+    glUseProgram(m_program);
+    glUniform1i(glGetUniformLocation(m_program, "screen"), 0);
+    glUniform1i(glGetUniformLocation(m_program, "palette"), 1);
+    glUseProgram(0);
+  }
+}
+
+PaletteShader::~PaletteShader() {
+  glDeleteProgram(m_program);
+}
+
+bool PaletteShader::valid() const {
+  return m_program != 0;
+}
+
+void PaletteShader::bind() const {
+  glUseProgram(m_program);
+}
+
+void PaletteShader::unbind() const {
+  glUseProgram(0);
+}
+
+
 //---------------------------------------------------
 // General GL Calls
 //---------------------------------------------------
@@ -88,3 +183,22 @@ void draw_texture(const Texture& tex) {
   tex.unbind();
 }
 
+void draw_indexed(const Texture& tex, const Texture& palette, const PaletteShader& shader) {
+  glActiveTexture(GL_TEXTURE1);
+  palette.bind();
+  glActiveTexture(GL_TEXTURE0);
+  tex.bind();
+  shader.bind();
+  glBegin(GL_QUADS);
+  glTexCoord2f(0.0f, 0.0f); glVertex2f(-1, 1);
+  glTexCoord2f(1.0f, 0.0f); glVertex2f(1, 1);
+  glTexCoord2f(1.0f, 1.0f); glVertex2f(1, -1);
+  glTexCoord2f(0.0f, 1.0f); glVertex2f(-1, -1);
+  glEnd();
+  shader.unbind();
+  tex.unbind();
+  glActiveTexture(GL_TEXTURE1);
+  palette.unbind();
+  glActiveTexture(GL_TEXTURE0);
+}
+
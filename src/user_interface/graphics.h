@@ -11,11 +11,21 @@
 // Texture
 //---------------------------------------------------
 
+// Rgba is 4 bytes per texel, Index a single byte (GL_R8) read as 0 to 1
+enum class TextureFormat {
+  Rgba,
+  Index,
+};
+
 class Texture {
   public:
-    Texture(std::size_t width, std::size_t height);
+    Texture(std::size_t width, std::size_t height, TextureFormat format = TextureFormat::Rgba);
     ~Texture();
 
+    // Reallocates the texture, its contents are undefined until updated
+    void resize(std::size_t width, std::size_t height);
+
+    // Uploads a region from width * height tightly packed texels
     void update(
         std::size_t x_offset,
         std::size_t y_offset,
@@ -34,6 +44,34 @@ class Texture {
 
   private:
     GLuint m_id{0};
+    TextureFormat m_format;
+
+};
+
+
+//---------------------------------------------------
+// PaletteShader
+//---------------------------------------------------
+
+// Shows an Index texture through a 256 x 1 Rgba palette texture, each
+// texel's byte picks its colour
+class PaletteShader {
+  public:
+    PaletteShader();
+    ~PaletteShader();
+
+    bool valid() const;
+
+    void bind() const;
+    void unbind() const;
+
+    PaletteShader(const PaletteShader& other) = delete;
+    PaletteShader(PaletteShader&& other) = delete;
+    PaletteShader& operator=(const PaletteShader& other) = delete;
+    PaletteShader& operator=(PaletteShader&& other) = delete;
+
+  private:
+    GLuint m_program{0};
 
 };
 
@@ -48,4 +86,6 @@ void clear();
 
 void draw_texture(const Texture& tex);
 
+void draw_indexed(const Texture& tex, const Texture& palette, const PaletteShader& shader);
+
 
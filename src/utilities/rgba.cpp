@@ -0,0 +1,226 @@
+/*  @file   rgba.cpp
+ *  @brief  Kernels turning screen bytes into RGBA pixels.
+ *  @author Ryan V. Ngo
+ */
+
+#include "rgba.h"
+
+#include <algorithm>
+#include <cstring>
+
+// SSE2 is part of x86-64, AVX2 kernels are picked at run time
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(REM8CPP_NO_SIMD)
+#include <immintrin.h>
+#define REM8CPP_SIMD 1
+#else
+#define REM8CPP_SIMD 0
+#endif
+
+
+#define PLANE_COUNT           2
+
+
+static void rgba_lookup_scalar(const uint8_t* screen, std::size_t count, const uint32_t* palette, unsigned char* out) {
+  for (std::size_t i = 0; i < count; i += 8) {
+    uint64_t pixels;
+    memcpy(&pixels, &screen[i], sizeof(pixels));
+    for (int lane = 0; lane < 8; lane++, out += 4) {
+      memcpy(out, &palette[(pixels >> (8 * lane)) & 0xFF], 4);
+    }
+  }
+}
+
+// Sprite weight out of 256 for the mixing blend modes, normal takes all of it
+static int blend_weight(uint8_t mode) {
+  return mode >= REM8CPP_BLEND_25 && mode <= REM8CPP_BLEND_75 ? 64 * mode : 256;
+}
+
+// Whether the mode puts the sprite colour down as it is
+static bool blend_replaces(uint8_t mode) {
+  return mode != REM8CPP_BLEND_ADD && mode != REM8CPP_BLEND_MULTIPLY && blend_weight(mode) == 256;
+}
+
+static uint8_t blend_channel(uint8_t s, uint8_t d, uint8_t mode) {
+  if (blend_replaces(mode)) return s;
+  if (mode == REM8CPP_BLEND_ADD) return std::min(s + d, 0xFF);
+  if (mode == REM8CPP_BLEND_MULTIPLY) return (s * d + 0xFF) >> 8;
+  const int weight = blend_weight(mode);
+  return (s * weight + d * (256 - weight)) >> 8;
+}
+
+static bool rgba_blend_scalar(const uint8_t* sprite, std::size_t count, const uint32_t* palette, uint8_t mode, uint32_t* layer) {
+  bool changed = false;
+  for (std::size_t i = 0; i < count; i++) {
+    if (sprite[i] == 0) continue;
+    const uint32_t s = palette[sprite[i]];
+    const uint32_t d = layer[i];
+    uint32_t mixed = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+      mixed |= uint32_t{blend_channel(s >> shift, d >> shift, mode)} << shift;
+    }
+    changed |= mixed != d;
+    layer[i] = mixed;
+  }
+  return changed;
+}
+
+#if REM8CPP_SIMD
+
+// Works a colour channel at a time over 16 pixels. With plane 1 and 2 bit
+// masks b1 and b2 the channel is c0 ^ b1 & (c0 ^ c1) ^ b2 & (c0 ^ c2) ^
+// b1 & b2 & (c0 ^ c1 ^ c2 ^ c3), then the channels are interleaved into RGBA.
+static void rgba_planes_sse2(const uint8_t* screen, std::size_t count, const uint32_t* palette, unsigned char* out) {
+  const __m128i plane1 = _mm_set1_epi8(1);
+  const __m128i plane2 = _mm_set1_epi8(2);
+  __m128i base[4], only1[4], only2[4], both[4];
+  for (int channel = 0; channel < 4; channel++) {
+    uint8_t c[1 << PLANE_COUNT];
+    for (int i = 0; i < 1 << PLANE_COUNT; i++) c[i] = palette[i] >> (8 * channel);
+    base[channel] = _mm_set1_epi8(c[0]);
+    only1[channel] = _mm_set1_epi8(c[0] ^ c[1]);
+    only2[channel] = _mm_set1_epi8(c[0] ^ c[2]);
+    both[channel] = _mm_set1_epi8(c[0] ^ c[1] ^ c[2] ^ c[3]);
+  }
+
+  for (std::size_t i = 0; i < count; i += 16, out += 64) {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&screen[i]));
+    __m128i b1 = _mm_cmpeq_epi8(_mm_and_si128(bytes, plane1), plane1);
+    __m128i b2 = _mm_cmpeq_epi8(_mm_and_si128(bytes, plane2), plane2);
+    __m128i b12 = _mm_and_si128(b1, b2);
+    __m128i channels[4];
+    for (int channel = 0; channel < 4; channel++) {
+      __m128i value = _mm_xor_si128(base[channel], _mm_and_si128(b1, only1[channel]));
+      value = _mm_xor_si128(value, _mm_and_si128(b2, only2[channel]));
+      channels[channel] = _mm_xor_si128(value, _mm_and_si128(b12, both[channel]));
+    }
+    __m128i rg_low = _mm_unpacklo_epi8(channels[0], channels[1]);
+    __m128i rg_high = _mm_unpackhi_epi8(channels[0], channels[1]);
+    __m128i ba_low = _mm_unpacklo_epi8(channels[2], channels[3]);
+    __m128i ba_high = _mm_unpackhi_epi8(channels[2], channels[3]);
+    __m128i* rgba = reinterpret_cast<__m128i*>(out);
+    _mm_storeu_si128(rgba + 0, _mm_unpacklo_epi16(rg_low, ba_low));
+    _mm_storeu_si128(rgba + 1, _mm_unpackhi_epi16(rg_low, ba_low));
+    _mm_storeu_si128(rgba + 2, _mm_unpacklo_epi16(rg_high, ba_high));
+    _mm_storeu_si128(rgba + 3, _mm_unpackhi_epi16(rg_high, ba_high));
+  }
+}
+
+// The plane colours fit one register, a lane permute looks up 8 pixels
+__attribute__((target("avx2")))
+static void rgba_planes_avx2(const uint8_t* screen, std::size_t count, const uint32_t* palette, unsigned char* out) {
+  const __m256i colors = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(palette));
+  for (std::size_t i = 0; i < count; i += 8, out += 32) {
+    __m256i pixels = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&screen[i])));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_permutevar8x32_epi32(colors, pixels));
+  }
+}
+
+// MEGA-CHIP indices gather from the whole palette
+__attribute__((target("avx2")))
+static void rgba_lookup_avx2(const uint8_t* screen, std::size_t count, const uint32_t* palette, unsigned char* out) {
+  const int* entries = reinterpret_cast<const int*>(palette);
+  for (std::size_t i = 0; i < count; i += 8, out += 32) {
+    __m256i pixels = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&screen[i])));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_i32gather_epi32(entries, pixels, 4));
+  }
+}
+
+// Channels are widened to 16 bits where the blend mode mixes them, no sum
+// gets past 255 * 256
+static __m128i blend_sse2(__m128i s, __m128i d, uint8_t mode, __m128i sprite_weight, __m128i layer_weight) {
+  if (mode == REM8CPP_BLEND_ADD) return _mm_adds_epu8(s, d);
+  const __m128i zero = _mm_setzero_si128();
+  __m128i halves[2];
+  for (int half = 0; half < 2; half++) {
+    __m128i s16 = half ? _mm_unpackhi_epi8(s, zero) : _mm_unpacklo_epi8(s, zero);
+    __m128i d16 = half ? _mm_unpackhi_epi8(d, zero) : _mm_unpacklo_epi8(d, zero);
+    __m128i sum = mode == REM8CPP_BLEND_MULTIPLY
+                ? _mm_add_epi16(_mm_mullo_epi16(s16, d16), _mm_set1_epi16(0xFF))
+                : _mm_add_epi16(_mm_mullo_epi16(s16, sprite_weight), _mm_mullo_epi16(d16, layer_weight));
+    halves[half] = _mm_srli_epi16(sum, 8);
+  }
+  return _mm_packus_epi16(halves[0], halves[1]);
+}
+
+// 4 pixels at a time, the colours are looked up one by one. Fully
+// transparent runs are stepped over.
+static bool rgba_blend_sse2(const uint8_t* sprite, std::size_t count, const uint32_t* palette, uint8_t mode, uint32_t* layer) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i sprite_weight = _mm_set1_epi16(blend_weight(mode));
+  const __m128i layer_weight = _mm_set1_epi16(256 - blend_weight(mode));
+  const bool replace = blend_replaces(mode);
+  int unchanged = 0xFFFF;
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    uint32_t indices;
+    memcpy(&indices, &sprite[i], sizeof(indices));
+    if (indices == 0) continue;
+    __m128i transparent = _mm_cmpeq_epi32(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(indices), zero), zero), zero);
+    __m128i s = _mm_set_epi32(palette[sprite[i + 3]], palette[sprite[i + 2]], palette[sprite[i + 1]], palette[sprite[i]]);
+    __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&layer[i]));
+    __m128i mixed = replace ? s : blend_sse2(s, d, mode, sprite_weight, layer_weight);
+    __m128i out = _mm_or_si128(_mm_and_si128(transparent, d), _mm_andnot_si128(transparent, mixed));
+    unchanged &= _mm_movemask_epi8(_mm_cmpeq_epi8(out, d));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&layer[i]), out);
+  }
+  bool changed = rgba_blend_scalar(sprite + i, count - i, palette, mode, layer + i);
+  return changed || unchanged != 0xFFFF;
+}
+
+__attribute__((target("avx2")))
+static __m256i blend_avx2(__m256i s, __m256i d, uint8_t mode, __m256i sprite_weight, __m256i layer_weight) {
+  if (mode == REM8CPP_BLEND_ADD) return _mm256_adds_epu8(s, d);
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i halves[2];
+  for (int half = 0; half < 2; half++) {
+    __m256i s16 = half ? _mm256_unpackhi_epi8(s, zero) : _mm256_unpacklo_epi8(s, zero);
+    __m256i d16 = half ? _mm256_unpackhi_epi8(d, zero) : _mm256_unpacklo_epi8(d, zero);
+    __m256i sum = mode == REM8CPP_BLEND_MULTIPLY
+                ? _mm256_add_epi16(_mm256_mullo_epi16(s16, d16), _mm256_set1_epi16(0xFF))
+                : _mm256_add_epi16(_mm256_mullo_epi16(s16, sprite_weight), _mm256_mullo_epi16(d16, layer_weight));
+    halves[half] = _mm256_srli_epi16(sum, 8);
+  }
+  return _mm256_packus_epi16(halves[0], halves[1]);
+}
+
+// 8 pixels at a time with the colours gathered, the unpacks and the pack
+// stay within 128-bit lanes so pixels keep their place
+__attribute__((target("avx2")))
+static bool rgba_blend_avx2(const uint8_t* sprite, std::size_t count, const uint32_t* palette, uint8_t mode, uint32_t* layer) {
+  const int* entries = reinterpret_cast<const int*>(palette);
+  const __m256i sprite_weight = _mm256_set1_epi16(blend_weight(mode));
+  const __m256i layer_weight = _mm256_set1_epi16(256 - blend_weight(mode));
+  const bool replace = blend_replaces(mode);
+  int unchanged = -1;
+  std::size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    uint64_t bytes;
+    memcpy(&bytes, &sprite[i], sizeof(bytes));
+    if (bytes == 0) continue;
+    __m256i indices = _mm256_cvtepu8_epi32(_mm_cvtsi64_si128(bytes));
+    __m256i transparent = _mm256_cmpeq_epi32(indices, _mm256_setzero_si256());
+    __m256i s = _mm256_i32gather_epi32(entries, indices, 4);
+    __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&layer[i]));
+    __m256i mixed = replace ? s : blend_avx2(s, d, mode, sprite_weight, layer_weight);
+    __m256i out = _mm256_blendv_epi8(mixed, d, transparent);
+    unchanged &= _mm256_movemask_epi8(_mm256_cmpeq_epi8(out, d));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(&layer[i]), out);
+  }
+  bool changed = rgba_blend_scalar(sprite + i, count - i, palette, mode, layer + i);
+  return changed || unchanged != -1;
+}
+
+#endif
+
+
+const std::vector<rem8RgbaKernels>& rgba_kernels() {
+  static const std::vector<rem8RgbaKernels> kernels = [] {
+    std::vector<rem8RgbaKernels> kernels = {{"scalar", rgba_lookup_scalar, rgba_lookup_scalar, rgba_blend_scalar}};
+#if REM8CPP_SIMD
+    kernels.push_back({"sse2", rgba_planes_sse2, rgba_lookup_scalar, rgba_blend_sse2});
+    if (__builtin_cpu_supports("avx2")) kernels.push_back({"avx2", rgba_planes_avx2, rgba_lookup_avx2, rgba_blend_avx2});
+#endif
+    return kernels;
+  }();
+  return kernels;
+}
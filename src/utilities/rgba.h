@@ -0,0 +1,41 @@
+/*  @file   rgba.h
+ *  @brief  Kernels turning screen bytes into RGBA pixels.
+ *  @author Ryan V. Ngo
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+// Writes the palette entry of count pixels (a multiple of 16) to out
+using rem8RgbaKernel = void (*)(const uint8_t* screen, std::size_t count, const uint32_t* palette, unsigned char* out);
+
+// Mixes the palette entry of count MEGA-CHIP sprite pixels (any count) into
+// layer with a blend mode, index 0 is transparent. Returns whether a layer
+// pixel changed.
+using rem8BlendKernel = bool (*)(const uint8_t* sprite, std::size_t count, const uint32_t* palette, uint8_t mode, uint32_t* layer);
+
+// Blend modes, each channel of the sprite colour s mixed with the layer's d.
+// Other modes replace like REM8CPP_BLEND_NORMAL.
+#define REM8CPP_BLEND_NORMAL     0  // s
+#define REM8CPP_BLEND_25         1  // (s * 64 + d * 192) / 256
+#define REM8CPP_BLEND_50         2  // (s * 128 + d * 128) / 256
+#define REM8CPP_BLEND_75         3  // (s * 192 + d * 64) / 256
+#define REM8CPP_BLEND_ADD        4  // s + d, saturating
+#define REM8CPP_BLEND_MULTIPLY   5  // (s * d + 255) / 256
+
+// planes only takes plane bits and looks at the first 4 palette entries,
+// lookup takes any byte
+struct rem8RgbaKernels {
+  const char* name;
+  rem8RgbaKernel planes;
+  rem8RgbaKernel lookup;
+  rem8BlendKernel blend;
+};
+
+// Every kernel set the host runs, plain C++ first and the widest last
+const std::vector<rem8RgbaKernels>& rgba_kernels();
+
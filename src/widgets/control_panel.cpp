@@ -10,6 +10,27 @@
 #include "imgui.h"
 
 
+// Profile a ROM was written for, going by the usual file extensions. Anything
+// else keeps the profile picked in the panel.
+static bool quirks_for_rom(const std::filesystem::path& rom, rem8Quirks& quirks) {
+  auto ext = rom.extension();
+  if (ext == ".ch8") quirks = rem8Quirks::Vip;
+  else if (ext == ".sc8") quirks = rem8Quirks::Schip;
+  else if (ext == ".xo8") quirks = rem8Quirks::XoChip;
+  else if (ext == ".mc8") quirks = rem8Quirks::MegaChip;
+  else return false;
+  return true;
+}
+
+// Opaque RGBA with R in the low byte, as the emulator takes plane colours
+static uint32_t pack_rgba(const float color[3]) {
+  uint32_t rgba = 0xFF000000;
+  for (int channel = 0; channel < 3; channel++) {
+    rgba |= static_cast<uint32_t>(color[channel] * 255.0f + 0.5f) << (8 * channel);
+  }
+  return rgba;
+}
+
 ControlPanel::ControlPanel(rem8Cpp& emulator) 
   : m_emulator(emulator),
     m_io(ImGui::GetIO()),
@@ -21,6 +42,8 @@ ControlPanel::ControlPanel(rem8Cpp& emulator)
     m_load_addr(0x0200),
     m_start_addr(0x0200),
     m_clock_rate(1000),
+    m_foreground{1.0f, 1.0f, 1.0f},
+    m_background{0.0f, 0.0f, 0.0f},
     reload_(false)
 { }
 
@@ -51,12 +74,36 @@ void ControlPanel::render() {
 
   ImGui::DragScalar("Load Addr", ImGuiDataType_U16, &m_load_addr, 1.0f, NULL, NULL, "0x%04X");
   ImGui::DragScalar("Start Addr", ImGuiDataType_U16, &m_start_addr, 1.0f, NULL, NULL, "0x%04X");
-  ImGui::DragInt("Clock Rate", &m_clock_rate, 1.0f, 0, 20000, "%d HZ");
+  // VIP timing counts the VIP's machine cycles, so it runs at the VIP's clock
+  if (m_emulator.timing() == rem8Timing::Vip) {
+    ImGui::Text("Clock Rate: %d HZ", REM8CPP_VIP_CLOCK_RATE);
+  } else {
+    ImGui::DragInt("Clock Rate", &m_clock_rate, 1.0f, 0, 20000, "%d HZ");
+  }
+
+  // Profiles in rem8Quirks order
+  const char* quirk_profiles[] = {"COSMAC VIP", "SUPER-CHIP", "XO-CHIP", "MEGA-CHIP"};
+  int quirks = static_cast<int>(m_emulator.quirks());
+  if (ImGui::Combo("Quirks", &quirks, quirk_profiles, IM_ARRAYSIZE(quirk_profiles))) {
+    m_emulator.set_quirks(static_cast<rem8Quirks>(quirks));
+  }
+
+  // Timing models in rem8Timing order
+  const char* timing_models[] = {"Instructions", "COSMAC VIP"};
+  int timing = static_cast<int>(m_emulator.timing());
+  if (ImGui::Combo("Timing", &timing, timing_models, IM_ARRAYSIZE(timing_models))) {
+    m_emulator.set_timing(static_cast<rem8Timing>(timing));
+  }
+
+  if (ImGui::ColorEdit3("Foreground", m_foreground)) m_emulator.set_plane_color(0x01, pack_rgba(m_foreground));
+  if (ImGui::ColorEdit3("Background", m_background)) m_emulator.set_plane_color(0x00, pack_rgba(m_background));
 
   if (file_explorer_.is_shown()) {
     file_explorer_.render();
     if (!file_explorer_.is_shown()) {
       m_selected_rom = file_explorer_.get_selected_path();
+      rem8Quirks rom_quirks;
+      if (quirks_for_rom(m_selected_rom, rom_quirks)) m_emulator.set_quirks(rom_quirks);
       reload_ = true;
       m_pause = true;
     }
@@ -68,10 +115,15 @@ void ControlPanel::render() {
 
   ImGui::Text("DIAGNOSTICS"); 
   ImGui::Text("Program Counter:   0x%04hX", m_emulator.program_counter()); // Program Counter
-  ImGui::Text("Address Register:  0x%04hX", m_emulator.I_register());      // Address Register
+  ImGui::Text("Address Register:  0x%06X", m_emulator.I_register());       // Address Register
   ImGui::Text("Stack Pointer:     0x%04hX", m_emulator.stack_pointer());   // Stack Pointer 
   ImGui::Text("Delay Timer:       0x%02hhX", m_emulator.delay_timer());    // Stack Pointer 
   ImGui::Text("Sound Timer:       0x%02hhX", m_emulator.sound_timer());    // Stack Pointer 
+  ImGui::Text("Idle:              %s", m_emulator.idle() ? "yes" : "no");   // Waiting on timers or keys
+  ImGui::Text("Fault:             %s", m_emulator.fault() == rem8Fault::StackOverflow ? "stack overflow" :
+                                          m_emulator.fault() == rem8Fault::StackUnderflow ? "stack underflow" : "none");
+  ImGui::Text("Exited:            %s", m_emulator.exited() ? "yes" : "no");  // 00FD
+  ImGui::Text("Resolution:        %zux%zu", m_emulator.width(), m_emulator.height());
 
   // Data Registers
   for (uint8_t i = 0; i < 0x10; i++) {
@@ -106,6 +158,7 @@ uint16_t ControlPanel::start_addr() const {
   return m_start_addr;
 }
 
+// The rate chosen for instruction timing, also while VIP timing runs at its own
 int ControlPanel::clock_rate() const {
   return m_clock_rate;
 }
@@ -40,6 +40,8 @@ class ControlPanel : public IWidget {
     uint16_t m_load_addr;
     uint16_t m_start_addr;
     int m_clock_rate;
+    float m_foreground[3];
+    float m_background[3];
 
     bool reload_;
 
@@ -9,11 +9,37 @@
 #include "imgui_impl_opengl3.h"
 
 
+// FNV-1a over size bytes at data
+static uint64_t hash_bytes(uint64_t hash, const void* data, std::size_t size) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (std::size_t i = 0; i < size; i++) {
+    hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+  }
+  return hash;
+}
+
+// Geometry and clipping of every draw command, what ends up on screen
+static uint64_t hash_draw_data(uint64_t hash, const ImDrawData* draw_data) {
+  if (!draw_data) return hash;
+  hash = hash_bytes(hash, &draw_data->DisplayPos, sizeof(draw_data->DisplayPos));
+  hash = hash_bytes(hash, &draw_data->DisplaySize, sizeof(draw_data->DisplaySize));
+  for (const ImDrawList* list : draw_data->CmdLists) {
+    hash = hash_bytes(hash, list->VtxBuffer.Data, list->VtxBuffer.size_in_bytes());
+    hash = hash_bytes(hash, list->IdxBuffer.Data, list->IdxBuffer.size_in_bytes());
+    for (const ImDrawCmd& cmd : list->CmdBuffer) {
+      hash = hash_bytes(hash, &cmd.ClipRect, sizeof(cmd.ClipRect));
+      hash = hash_bytes(hash, &cmd.ElemCount, sizeof(cmd.ElemCount));
+    }
+  }
+  return hash;
+}
+
+
 //---------------------------------------------------
 // WidgetRunner
 //---------------------------------------------------
 
-WidgetRunner::WidgetRunner(GLFWwindow* window) {
+WidgetRunner::WidgetRunner(GLFWwindow* window) : m_draw_hash(0) {
   // Setup Dear ImGui context
   IMGUI_CHECKVERSION();
   ImGui::CreateContext();
@@ -43,7 +69,9 @@ void WidgetRunner::add_widget(IWidget* widget) {
   m_widgets.push_back(widget);
 }
 
-void WidgetRunner::render() {
+// Platform windows are created and moved here as well, only drawing them
+// waits for render()
+bool WidgetRunner::update() {
   ImGui_ImplOpenGL3_NewFrame();
   ImGui_ImplGlfw_NewFrame();
   ImGui::NewFrame();
@@ -51,11 +79,27 @@ void WidgetRunner::render() {
     widget->render();
   }
   ImGui::Render();
-  ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
+  uint64_t hash = hash_draw_data(0xCBF29CE484222325ull, ImGui::GetDrawData());
   if (ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
     GLFWwindow* backup_current_context = glfwGetCurrentContext();
     ImGui::UpdatePlatformWindows();
+    glfwMakeContextCurrent(backup_current_context);
+    for (const ImGuiViewport* viewport : ImGui::GetPlatformIO().Viewports) {
+      hash = hash_draw_data(hash, viewport->DrawData);
+    }
+  }
+
+  bool changed = hash != m_draw_hash;
+  m_draw_hash = hash;
+  return changed;
+}
+
+void WidgetRunner::render() {
+  ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+  if (ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
+    GLFWwindow* backup_current_context = glfwGetCurrentContext();
     ImGui::RenderPlatformWindowsDefault();
     glfwMakeContextCurrent(backup_current_context);
   }
@@ -6,6 +6,7 @@
 
 #include <GLFW/glfw3.h>
 
+#include <cstdint>
 #include <vector>
 
 
@@ -20,6 +21,12 @@ class WidgetRunner {
     ~WidgetRunner();
 
     void add_widget(IWidget* widget);
+
+    // Builds this frame's UI, returns whether it looks any different from
+    // the last one built
+    bool update();
+
+    // Draws the UI built by update()
     void render();
 
     WidgetRunner(const WidgetRunner& other) = delete;
@@ -29,6 +36,7 @@ class WidgetRunner {
 
   private:
     std::vector<IWidget*> m_widgets;
+    uint64_t m_draw_hash;
 
 };
 
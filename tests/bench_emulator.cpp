@@ -0,0 +1,286 @@
+/*  @file   bench_emulator.cpp
+ *  @brief  Throughput benchmarks for the rem8C++ core.
+ *  @author Ryan V. Ngo
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "emulator.h"
+
+
+// Helper Functions - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - //
+
+std::vector<char> to_bytes(const std::vector<uint16_t>& instrs) {
+  std::vector<char> program;
+  for (auto instr : instrs) {
+    program.push_back((instr & 0xFF00) >> 8);
+    program.push_back(instr & 0x00FF);
+  }
+  return program;
+}
+
+// Tight loop touching every decode group, including the 0x8/0xE/0xF sub-groups
+std::vector<char> dispatch_program() {
+  std::vector<uint16_t> instrs = {
+    0x6005, // 0x200: V0 = 0x05
+    0x6103, // 0x202: V1 = 0x03
+    0x7001, // 0x204: V0 += 0x01
+    0x8014, // 0x206: V0 += V1
+    0x8206, // 0x208: V2 = V0 >> 1
+    0x8123, // 0x20A: V1 ^= V2
+    0xE19E, // 0x20C: skip if key V1 pressed
+    0xF107, // 0x20E: V1 = delay timer
+    0xA300, // 0x210: I = 0x300
+    0xF21E, // 0x212: I += V2
+    0x9010, // 0x214: skip if V0 != V1
+    0x8125, // 0x216: V1 -= V2
+    0x1204, // 0x218: jump to 0x204
+  };
+  return to_bytes(instrs);
+}
+
+// Sprite loop shaped like game code, made of fusable pairs
+std::vector<char> fusion_program() {
+  std::vector<uint16_t> instrs = {
+    0x6000, // 0x200: V0 = 0x00
+    0x6100, // 0x202: V1 = 0x00
+    0x6208, // 0x204: V2 = 0x08
+    0x6310, // 0x206: V3 = 0x10
+    0xA300, // 0x208: I = 0x300
+    0xD011, // 0x20A: draw 1 row at (V0, V1)
+    0x7001, // 0x20C: V0 += 0x01
+    0x3040, // 0x20E: skip if V0 == 0x40
+    0x1208, // 0x210: jump to 0x208
+    0x7101, // 0x212: V1 += 0x01
+    0x4120, // 0x214: skip if V1 != 0x20
+    0x1200, // 0x216: jump to 0x200
+    0x6000, // 0x218: V0 = 0x00
+    0x1208, // 0x21A: jump to 0x208
+  };
+  return to_bytes(instrs);
+}
+
+// Loop made of the instructions addressing memory through I
+std::vector<char> memory_program() {
+  std::vector<uint16_t> instrs = {
+    0x6000, // 0x200: V0 = 0x00
+    0x6108, // 0x202: V1 = 0x08
+    0xA300, // 0x204: I = 0x300
+    0xF01E, // 0x206: I += V0
+    0xF033, // 0x208: store BCD of V0
+    0xF755, // 0x20A: store V0-V7
+    0xA300, // 0x20C: I = 0x300
+    0xF765, // 0x20E: load V0-V7
+    0xD118, // 0x210: draw 8 rows at (V1, V1)
+    0x7001, // 0x212: V0 += 0x01
+    0x1204, // 0x214: jump to 0x204
+  };
+  return to_bytes(instrs);
+}
+
+// High resolution frame loop, a 16x16 sprite drawn then scrolled down and right
+std::vector<char> schip_program() {
+  std::vector<uint16_t> instrs = {
+    0x00FF, // 0x200: high resolution
+    0x6000, // 0x202: V0 = 0x00
+    0xA000, // 0x204: I = 0x000
+    0xD000, // 0x206: draw 16x16 at (V0, V0)
+    0x00C1, // 0x208: scroll down 1 row
+    0x00FB, // 0x20A: scroll right 4 pixels
+    0x7003, // 0x20C: V0 += 0x03
+    0x1204, // 0x20E: jump to 0x204
+  };
+  return to_bytes(instrs);
+}
+
+// Low resolution sprites walking across the screen, most rows unaligned and
+// every eighth one clipped at the right edge
+std::vector<char> sprite_program() {
+  std::vector<uint16_t> instrs = {
+    0x6000, // 0x200: V0 = 0x00
+    0x6100, // 0x202: V1 = 0x00
+    0xA000, // 0x204: I = 0x000
+    0xD01F, // 0x206: draw 8x15 at (V0, V1)
+    0x7009, // 0x208: V0 += 0x09
+    0x7103, // 0x20A: V1 += 0x03
+    0x1204, // 0x20C: jump to 0x204
+  };
+  return to_bytes(instrs);
+}
+
+// MEGA-CHIP sprite drawing, 32x32 palette indices blitted with a blend mode
+// and scrolled
+std::vector<char> megachip_program(uint16_t blend) {
+  std::vector<uint16_t> instrs = {
+    0x0011, // 0x200: MEGA-CHIP mode
+    0x0320, // 0x202: sprite width 32
+    0x0420, // 0x204: sprite height 32
+    blend,  // 0x206: blend mode
+    0x6000, // 0x208: V0 = 0x00
+    0xA000, // 0x20A: I = 0x000
+    0xD001, // 0x20C: draw 32x32 at (V0, V0)
+    0x00B1, // 0x20E: scroll up 1 row
+    0x7005, // 0x210: V0 += 0x05
+    0x120A, // 0x212: jump to 0x20A
+  };
+  return to_bytes(instrs);
+}
+
+// Best of several runs, the machine this runs on is rarely quiet
+template <typename Step>
+double measure_mips(uint64_t cycles, Step step) {
+  double best = 0.0;
+  for (int run = 0; run < 5; run++) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < cycles; i++) {
+      step();
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed = end - start;
+    best = std::max(best, cycles / elapsed.count() / 1e6);
+  }
+  return best;
+}
+
+
+// Benchmarks - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - //
+
+void bench_dispatch(uint64_t cycles) {
+  auto program = dispatch_program();
+
+  auto em_switch = rem8Cpp();
+  em_switch.load_rom(0x200, program, program.size());
+  double switch_mips = measure_mips(cycles, [&] { em_switch.cycle_reference(); });
+
+  auto em_cached = rem8Cpp();
+  em_cached.load_rom(0x200, program, program.size());
+  double cached_mips = measure_mips(cycles, [&] { em_cached.cycle(); });
+
+  auto em_threaded = rem8Cpp();
+  em_threaded.load_rom(0x200, program, program.size());
+  const uint32_t slice = 10'000;
+  double threaded_mips = measure_mips(cycles / slice, [&] { em_threaded.run(slice); }) * slice;
+
+  auto em_jit = rem8Cpp(rem8Engine::Jit);
+  em_jit.load_rom(0x200, program, program.size());
+  double jit_mips = measure_mips(cycles / slice, [&] { em_jit.run(slice); }) * slice;
+
+  printf("dispatch/switch    %8.2f MIPS\n", switch_mips);
+  printf("dispatch/cached    %8.2f MIPS  (%.2fx)\n", cached_mips, cached_mips / switch_mips);
+  printf("dispatch/threaded  %8.2f MIPS  (%.2fx)\n", threaded_mips, threaded_mips / switch_mips);
+  printf("dispatch/jit       %8.2f MIPS  (%.2fx)\n", jit_mips, jit_mips / switch_mips);
+}
+
+void bench_fusion(uint64_t cycles) {
+  auto program = fusion_program();
+
+  auto em_cached = rem8Cpp();
+  em_cached.load_rom(0x200, program, program.size());
+  double cached_mips = measure_mips(cycles, [&] { em_cached.cycle(); });
+
+  auto em_threaded = rem8Cpp();
+  em_threaded.load_rom(0x200, program, program.size());
+  const uint32_t slice = 10'000;
+  double threaded_mips = measure_mips(cycles / slice, [&] { em_threaded.run(slice); }) * slice;
+
+  auto em_jit = rem8Cpp(rem8Engine::Jit);
+  em_jit.load_rom(0x200, program, program.size());
+  double jit_mips = measure_mips(cycles / slice, [&] { em_jit.run(slice); }) * slice;
+
+  printf("fusion/cached      %8.2f MIPS\n", cached_mips);
+  printf("fusion/threaded    %8.2f MIPS  (%.2fx)\n", threaded_mips, threaded_mips / cached_mips);
+  printf("fusion/jit         %8.2f MIPS  (%.2fx)\n", jit_mips, jit_mips / cached_mips);
+}
+
+void bench_memory(uint64_t cycles) {
+  auto program = memory_program();
+
+  auto em_cached = rem8Cpp();
+  em_cached.load_rom(0x200, program, program.size());
+  double cached_mips = measure_mips(cycles, [&] { em_cached.cycle(); });
+
+  auto em_threaded = rem8Cpp();
+  em_threaded.load_rom(0x200, program, program.size());
+  const uint32_t slice = 10'000;
+  double threaded_mips = measure_mips(cycles / slice, [&] { em_threaded.run(slice); }) * slice;
+
+  printf("memory/cached      %8.2f MIPS\n", cached_mips);
+  printf("memory/threaded    %8.2f MIPS  (%.2fx)\n", threaded_mips, threaded_mips / cached_mips);
+}
+
+void bench_sprites(uint64_t cycles) {
+  auto program = sprite_program();
+
+  auto em_threaded = rem8Cpp();
+  em_threaded.load_rom(0x200, program, program.size());
+  const uint32_t slice = 10'000;
+  double threaded_mips = measure_mips(cycles / slice, [&] { em_threaded.run(slice); }) * slice;
+
+  printf("sprites/threaded   %8.2f MIPS\n", threaded_mips);
+}
+
+void bench_schip(uint64_t cycles) {
+  auto program = schip_program();
+
+  auto em_threaded = rem8Cpp();
+  em_threaded.load_rom(0x200, program, program.size());
+  const uint32_t slice = 10'000;
+  double threaded_mips = measure_mips(cycles / slice, [&] { em_threaded.run(slice); }) * slice;
+
+  printf("schip/threaded     %8.2f MIPS\n", threaded_mips);
+}
+
+void bench_megachip(uint64_t cycles) {
+  const uint32_t slice = 10'000;
+  for (auto [name, blend] : {std::pair{"threaded", 0x0800}, std::pair{"add", 0x0804}}) {
+    auto program = megachip_program(blend);
+    auto em_threaded = rem8Cpp();
+    em_threaded.set_quirks(rem8Quirks::MegaChip);
+    em_threaded.load_rom(0x200, program, program.size());
+    double threaded_mips = measure_mips(cycles / slice, [&] { em_threaded.run(slice); }) * slice;
+
+    printf("megachip/%-9s %8.2f MIPS\n", name, threaded_mips);
+  }
+}
+
+// Screen to RGBA conversion, in millions of pixels per second. Build with
+// -DREM8CPP_NO_SIMD to compare against the scalar kernel.
+void bench_screen(uint64_t frames) {
+  auto hires = rem8Cpp();
+  std::vector<uint16_t> hires_instrs = {0x00FF, 0xF301, 0xA000, 0xD010, 0x1206};
+  auto hires_program = to_bytes(hires_instrs);
+  hires.set_quirks(rem8Quirks::XoChip);
+  hires.load_rom(0x200, hires_program, hires_program.size());
+  hires.run(4);
+
+  auto mega = rem8Cpp();
+  std::vector<uint16_t> mega_instrs = {0x0011, 0x0340, 0x0440, 0xA000, 0xD000, 0x120A};
+  auto mega_program = to_bytes(mega_instrs);
+  mega.set_quirks(rem8Quirks::MegaChip);
+  mega.load_rom(0x200, mega_program, mega_program.size());
+  mega.run(5);
+
+  std::vector<unsigned char> buffer(REM8CPP_MEGA_WIDTH * REM8CPP_MEGA_HEIGHT * 4);
+  double hires_mpps = measure_mips(frames, [&] { hires.get_screen_rgba(buffer); }) * hires.width() * hires.height();
+  double mega_mpps = measure_mips(frames, [&] { mega.get_screen_rgba(buffer); }) * mega.width() * mega.height();
+
+  printf("screen/hires       %8.2f Mpixels/s\n", hires_mpps);
+  printf("screen/megachip    %8.2f Mpixels/s\n", mega_mpps);
+}
+
+int main() {
+  const uint64_t cycles = 20'000'000;
+  bench_dispatch(cycles);
+  bench_fusion(cycles);
+  bench_memory(cycles);
+  bench_sprites(cycles / 2);
+  bench_schip(cycles / 10);
+  bench_megachip(cycles / 10);
+  bench_screen(cycles / 2000);
+  return 0;
+}
+
@@ -0,0 +1,133 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+
+#include "emulator.h"
+#include "aot/aot.h"
+#include "aot/recompiler.h"
+#include "utilities/file.h"
+
+
+// Generated from roms/aot_test.ch8 by rem8C++-aot
+extern const rem8AotProgram aot_test_program;
+
+
+// Helper Functions - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - //
+
+std::vector<char> test_rom() {
+  return open_file(REM8_TEST_ROM_DIR "/aot_test.ch8");
+}
+
+void expect_same_state(const rem8Cpp& em, const rem8Cpp& ref) {
+  ASSERT_EQ(em.program_counter(), ref.program_counter());
+  ASSERT_EQ(em.I_register(), ref.I_register());
+  ASSERT_EQ(em.stack_pointer(), ref.stack_pointer());
+  ASSERT_EQ(em.delay_timer(), ref.delay_timer());
+  ASSERT_EQ(em.sound_timer(), ref.sound_timer());
+  for (uint8_t reg = 0x00; reg < 0x10; reg++) {
+    ASSERT_EQ(em.data_register(reg), ref.data_register(reg)) << "V" << std::hex << int(reg);
+  }
+  for (uint16_t addr = 0x000; addr < 0xFFF; addr++) {
+    ASSERT_EQ(em.read_memory(addr), ref.read_memory(addr)) << std::hex << addr;
+  }
+  ASSERT_TRUE(std::ranges::equal(em.get_screen(), ref.get_screen()));
+}
+
+// Tests - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - //
+
+TEST(rem8Recompiler, analysis__follows_control_flow) {
+  rem8Recompiler recompiler{test_rom()};
+
+  EXPECT_TRUE(recompiler.leader(0x200));
+  EXPECT_TRUE(recompiler.leader(0x208));  // loop target
+  EXPECT_TRUE(recompiler.leader(0x240));  // call target
+  EXPECT_TRUE(recompiler.leader(0x216));  // return address
+  EXPECT_TRUE(recompiler.leader(0x21A));  // skip successors
+  EXPECT_TRUE(recompiler.leader(0x21C));
+  EXPECT_TRUE(recompiler.leader(0x248));  // after DXYN
+  EXPECT_FALSE(recompiler.leader(0x20A));
+
+  EXPECT_TRUE(recompiler.reachable(0x272));
+  EXPECT_FALSE(recompiler.reachable(0x220));  // padding
+  EXPECT_FALSE(recompiler.reachable(0x224));  // only reached through BNNN
+}
+
+TEST(rem8Recompiler, blocks__stop_at_interpreted_instructions) {
+  rem8Recompiler recompiler{test_rom()};
+
+  const rem8Recompiler::Block* loop = nullptr;
+  for (const auto& block : recompiler.blocks()) {
+    if (block.addr == 0x208) loop = &block;
+  }
+  ASSERT_NE(loop, nullptr);
+  EXPECT_EQ(loop->length, 6);  // up to the 2NNN call
+}
+
+TEST(rem8Recompiler, generate__defines_program_symbol) {
+  rem8Recompiler recompiler{test_rom()};
+  std::string source = recompiler.generate("my_rom");
+
+  EXPECT_NE(source.find("const rem8AotProgram my_rom"), std::string::npos);
+  EXPECT_NE(source.find("void block_0208(rem8Cpp& em)"), std::string::npos);
+}
+
+TEST(rem8Aot, engine__selected_at_construction) {
+  EXPECT_EQ(rem8Cpp(aot_test_program).engine(), rem8Engine::Aot);
+}
+
+// Covers BNNN into code the recompiler never saw, calls, drawing and a
+// routine patched by FX55 that has to fall back to the interpreter
+TEST(rem8Aot, run__matches_interpreter) {
+  auto rom = test_rom();
+  auto em_aot = rem8Cpp(aot_test_program);
+  auto em_ref = rem8Cpp();
+  em_aot.load_rom(0x200, rom, rom.size());
+  em_ref.load_rom(0x200, rom, rom.size());
+
+  for (uint32_t done = 0, slice = 1; done < 2000; done += slice, slice = slice * 3 % 17 + 1) {
+    em_aot.run(slice);
+    em_ref.run(slice);
+  }
+
+  expect_same_state(em_aot, em_ref);
+  EXPECT_EQ(em_aot.data_register(0x03), 0x05);
+  EXPECT_EQ(em_aot.delay_timer(), 0x73 - 89);  // ticks since FX15 at the default clock rate
+}
+
+// Blocks are built for the VIP profile, any other one is interpreted. Only
+// the first loop iteration is run, its shifts are where the profiles differ.
+TEST(rem8Aot, set_quirks__other_profile_is_interpreted) {
+  auto rom = test_rom();
+  auto em_aot = rem8Cpp(aot_test_program);
+  auto em_ref = rem8Cpp();
+  em_aot.set_quirks(rem8Quirks::Schip);
+  em_ref.set_quirks(rem8Quirks::Schip);
+  em_aot.load_rom(0x200, rom, rom.size());
+  em_ref.load_rom(0x200, rom, rom.size());
+
+  em_aot.run(10);
+  em_ref.run(10);
+
+  expect_same_state(em_aot, em_ref);
+}
+
+TEST(rem8Recompiler, generate__records_quirks) {
+  rem8Recompiler recompiler{test_rom(), 0x200, rem8Quirks::Schip};
+  EXPECT_NE(recompiler.generate("my_rom").find("rem8Quirks::Schip"), std::string::npos);
+}
+
+// A different ROM leaves no block matching guest memory
+TEST(rem8Aot, load_rom__other_rom_is_interpreted) {
+  std::vector<char> other = {0x60, 0x11, 0x70, 0x01, 0x12, 0x02};
+  auto em_aot = rem8Cpp(aot_test_program);
+  auto em_ref = rem8Cpp();
+  em_aot.load_rom(0x200, other, other.size());
+  em_ref.load_rom(0x200, other, other.size());
+
+  em_aot.run(101);
+  em_ref.run(101);
+
+  expect_same_state(em_aot, em_ref);
+  EXPECT_EQ(em_aot.data_register(0x00), 0x11 + 50);
+}
+
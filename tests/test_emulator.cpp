@@ -1,7 +1,11 @@
 
 #include "gtest/gtest.h"
 
+#include <algorithm>
+#include <random>
+
 #include "emulator.h"
+#include "utilities/rgba.h"
 
 
 // Helper Functions - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - //
@@ -13,6 +17,15 @@ void load_instruction_at_pc(rem8Cpp& emulator, uint16_t instr) {
   emulator.load_rom(emulator.program_counter(), instr_data, sizeof(char) * 2);
 }
 
+void load_program(rem8Cpp& emulator, const std::vector<uint16_t>& instrs) {
+  std::vector<char> program;
+  for (auto instr : instrs) {
+    program.push_back((instr & 0xFF00) >> 8);
+    program.push_back(instr & 0x00FF);
+  }
+  emulator.load_rom(0x200, program, program.size());
+}
+
 void set_register(rem8Cpp& emulator, uint8_t reg, uint8_t val) {
   if (reg > 0x0F) return; // Only valid registers are 0x00 to 0x0F
   emulator.set_program_counter(0x200); // Set PC to a valid location
@@ -38,6 +51,151 @@ TEST(rem8Cpp, get_screen__blank) {
   }
 }
 
+// Every pixel comes out in the colour set for its planes, whichever kernel
+// the host picks
+TEST(rem8Cpp, get_screen_rgba__plane_colors) {
+  auto em = rem8Cpp();
+  em.set_quirks(rem8Quirks::XoChip);
+  load_program(em, {0xF301, 0x6103, 0xA000, 0xD015, 0x6037, 0xD015});
+  em.run(6);
+
+  const uint32_t colors[] = {0x80102030, 0xFF4080C0, 0xFF0000FF, 0x7F00FF00};
+  for (uint8_t planes = 0; planes < 4; planes++) em.set_plane_color(planes, colors[planes]);
+
+  std::vector<unsigned char> rgba(em.width() * em.height() * 4);
+  em.get_screen_rgba(rgba);
+  int seen[4] = {};
+  for (std::size_t i = 0; i < em.width() * em.height(); i++) {
+    uint32_t color;
+    memcpy(&color, &rgba[4 * i], sizeof(color));
+    ASSERT_EQ(color, colors[em.get_screen()[i]]) << i;
+    seen[em.get_screen()[i]]++;
+  }
+  EXPECT_GT(seen[1], 0);
+  EXPECT_GT(seen[2], 0);
+  EXPECT_GT(seen[3], 0);
+}
+
+// A sprite marks only the rows it covers, a clear marks every row
+TEST(rem8Cpp, dirty_rows__sprite_and_clear) {
+  auto em = rem8Cpp();
+  EXPECT_TRUE(em.dirty_rows().all());
+  em.clear_dirty_rows();
+  EXPECT_TRUE(em.dirty_rows().none());
+
+  load_program(em, {0x6104, 0xA000, 0xD013, 0x00E0});
+  em.run(3);
+  EXPECT_EQ(em.dirty_rows().count(), 3u);
+  EXPECT_TRUE(em.dirty_rows()[4]);
+  EXPECT_TRUE(em.dirty_rows()[6]);
+
+  em.clear_dirty_rows();
+  em.run(1);
+  EXPECT_TRUE(em.dirty_rows().all());
+}
+
+// Only clears and sprites that touch pixels start a new frame
+TEST(rem8Cpp, frame_generation__changes_with_pixels) {
+  auto em = rem8Cpp();
+  load_program(em, {0x00E0, 0xA300, 0xD011, 0xA000, 0xD011, 0x00E0});
+
+  uint64_t generation = em.frame_generation();
+  em.run(3);
+  EXPECT_EQ(em.frame_generation(), generation);
+  em.run(2);
+  EXPECT_GT(em.frame_generation(), generation);
+  generation = em.frame_generation();
+  em.run(1);
+  EXPECT_GT(em.frame_generation(), generation);
+}
+
+// MEGA-CHIP sprites only start a new frame and mark rows when a pixel changes,
+// transparent ones and redraws of the same pixels don't
+TEST(rem8Cpp, frame_generation__megachip_changes_with_pixels) {
+  auto em = rem8Cpp();
+  em.set_quirks(rem8Quirks::MegaChip);
+  load_program(em, {0x0011, 0x0302, 0x0402, 0x6010, 0xA300, 0xD010, 0xA214, 0xD010, 0xD010, 0x1212,
+                    0x0507, 0x0905});
+  em.run(4);
+  em.clear_dirty_rows();
+
+  uint64_t generation = em.frame_generation();
+  em.run(2);
+  EXPECT_EQ(em.frame_generation(), generation);
+  EXPECT_TRUE(em.dirty_rows().none());
+
+  em.run(2);
+  EXPECT_GT(em.frame_generation(), generation);
+  EXPECT_EQ(em.dirty_rows().count(), 2u);
+  EXPECT_TRUE(em.dirty_rows()[0]);
+  EXPECT_TRUE(em.dirty_rows()[1]);
+
+  em.clear_dirty_rows();
+  generation = em.frame_generation();
+  em.run(1);
+  EXPECT_EQ(em.frame_generation(), generation);
+  EXPECT_TRUE(em.dirty_rows().none());
+}
+
+// Every kernel set the host runs, not just the one get_screen_rgba picks,
+// matches the plain C++ one
+TEST(rem8Cpp, rgba_kernels__match_scalar) {
+  std::mt19937 rng(8);
+  std::vector<uint32_t> palette(0x100);
+  std::vector<uint8_t> planes(REM8CPP_MEGA_WIDTH * REM8CPP_MEGA_HEIGHT);
+  std::vector<uint8_t> indices(planes.size());
+  for (auto& color : palette) color = rng();
+  for (auto& pixel : planes) pixel = rng() & 0x03;
+  for (auto& pixel : indices) pixel = rng();
+
+  const rem8RgbaKernels& scalar = rgba_kernels().front();
+  std::vector<unsigned char> expected(4 * planes.size()), rgba(4 * planes.size());
+  for (const auto& kernels : rgba_kernels()) {
+    scalar.planes(planes.data(), planes.size(), palette.data(), expected.data());
+    kernels.planes(planes.data(), planes.size(), palette.data(), rgba.data());
+    EXPECT_EQ(rgba, expected) << kernels.name;
+
+    scalar.lookup(indices.data(), indices.size(), palette.data(), expected.data());
+    kernels.lookup(indices.data(), indices.size(), palette.data(), rgba.data());
+    EXPECT_EQ(rgba, expected) << kernels.name;
+  }
+
+  // Every blend mode and one past them, over a count that leaves a tail and
+  // sprites with transparent pixels
+  std::vector<uint32_t> layer(REM8CPP_MEGA_WIDTH - 5);
+  for (auto& pixel : layer) pixel = rng();
+  for (auto& pixel : indices) pixel = rng() % 3 ? pixel : 0;
+  for (const auto& kernels : rgba_kernels()) {
+    for (uint8_t mode = 0; mode <= REM8CPP_BLEND_MULTIPLY + 1; mode++) {
+      std::vector<uint32_t> expected_layer = layer, blended = layer;
+      bool expected_changed = scalar.blend(indices.data(), layer.size(), palette.data(), mode, expected_layer.data());
+      bool changed = kernels.blend(indices.data(), layer.size(), palette.data(), mode, blended.data());
+      EXPECT_EQ(blended, expected_layer) << kernels.name << " mode " << int(mode);
+      EXPECT_EQ(changed, expected_changed) << kernels.name << " mode " << int(mode);
+      if (mode == REM8CPP_BLEND_NORMAL) {
+        EXPECT_FALSE(kernels.blend(indices.data(), layer.size(), palette.data(), mode, blended.data())) << kernels.name;
+      }
+    }
+  }
+}
+
+// Converting a run of rows matches the same rows of the whole screen
+TEST(rem8Cpp, get_screen_rgba__rows) {
+  auto em = rem8Cpp();
+  load_program(em, {0x6104, 0xA000, 0xD013});
+  em.run(3);
+
+  std::vector<unsigned char> full(em.width() * em.height() * 4);
+  std::vector<unsigned char> rows(full.size(), 0xAA);
+  em.get_screen_rgba(full);
+  em.get_screen_rgba(rows, 4, 3);
+  const std::size_t pitch = em.width() * 4;
+  for (std::size_t i = 0; i < rows.size(); i++) {
+    if (i >= 4 * pitch && i < 7 * pitch) ASSERT_EQ(rows[i], full[i]) << i;
+    else ASSERT_EQ(rows[i], 0xAA) << i;
+  }
+}
+
 // Null instruction cycle
 TEST(rem8Cpp, cycle__blank) {
   auto em = rem8Cpp();
@@ -50,6 +208,670 @@ TEST(rem8Cpp, cycle__blank) {
   EXPECT_EQ(init_pc + 0x02, curr_pc);
 }
 
+// Table dispatch matches the reference switch for every opcode
+TEST(rem8Cpp, cycle__matches_reference) {
+  for (uint32_t instr = 0x0000; instr <= 0xFFFF; instr++) {
+    auto em_table = rem8Cpp();
+    auto em_switch = rem8Cpp();
+    load_program(em_table, {0x6112, 0x6234, static_cast<uint16_t>(instr)});
+    load_program(em_switch, {0x6112, 0x6234, static_cast<uint16_t>(instr)});
+
+    for (int i = 0; i < 3; i++) {
+      em_table.cycle();
+      em_switch.cycle_reference();
+    }
+
+    ASSERT_EQ(em_table.program_counter(), em_switch.program_counter()) << std::hex << instr;
+    ASSERT_EQ(em_table.I_register(), em_switch.I_register()) << std::hex << instr;
+    ASSERT_EQ(em_table.stack_pointer(), em_switch.stack_pointer()) << std::hex << instr;
+    for (uint8_t reg = 0x00; reg < 0x10; reg++) {
+      ASSERT_EQ(em_table.data_register(reg), em_switch.data_register(reg)) << std::hex << instr;
+    }
+  }
+}
+
+// Same for the 0NNN group and DXYN once MEGA-CHIP mode is on
+TEST(rem8Cpp, cycle__matches_reference__megachip) {
+  for (auto [instr, end] : {std::pair{0x0000u, 0x1000u}, std::pair{0xD000u, 0xD100u}}) {
+    for (; instr < end; instr++) {
+      auto em_table = rem8Cpp();
+      auto em_switch = rem8Cpp();
+      em_table.set_quirks(rem8Quirks::MegaChip);
+      em_switch.set_quirks(rem8Quirks::MegaChip);
+      load_program(em_table, {0x0011, 0x6112, static_cast<uint16_t>(instr), 0x0102, 0x0304});
+      load_program(em_switch, {0x0011, 0x6112, static_cast<uint16_t>(instr), 0x0102, 0x0304});
+
+      for (int i = 0; i < 3; i++) {
+        em_table.cycle();
+        em_switch.cycle_reference();
+      }
+
+      ASSERT_EQ(em_table.program_counter(), em_switch.program_counter()) << std::hex << instr;
+      ASSERT_EQ(em_table.I_register(), em_switch.I_register()) << std::hex << instr;
+      ASSERT_EQ(em_table.width(), em_switch.width()) << std::hex << instr;
+      ASSERT_EQ(em_table.data_register(0x0F), em_switch.data_register(0x0F)) << std::hex << instr;
+      ASSERT_TRUE(std::ranges::equal(em_table.get_screen(), em_switch.get_screen())) << std::hex << instr;
+    }
+  }
+}
+
+// Threaded run(n) lands in the same state as n calls to cycle()
+TEST(rem8Cpp, run__matches_cycle) {
+  std::vector<uint16_t> program = {
+    0x6005, 0x6103, 0x7001, 0x8014, 0x8206, 0x8123, 0xA300, 0xF233, 0xF265, 0x2220, 0x1204,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x7201, 0x00EE,
+  };
+
+  auto em_cycle = rem8Cpp();
+  auto em_run = rem8Cpp();
+  load_program(em_cycle, program);
+  load_program(em_run, program);
+
+  for (int i = 0; i < 1000; i++) em_cycle.cycle();
+  em_run.run(1000);
+
+  EXPECT_EQ(em_run.program_counter(), em_cycle.program_counter());
+  EXPECT_EQ(em_run.I_register(), em_cycle.I_register());
+  EXPECT_EQ(em_run.stack_pointer(), em_cycle.stack_pointer());
+  for (uint8_t reg = 0x00; reg < 0x10; reg++) {
+    EXPECT_EQ(em_run.data_register(reg), em_cycle.data_register(reg));
+  }
+}
+
+// Code rewritten by FX55 is decoded again before it runs
+TEST(rem8Cpp, cycle__self_modifying_code) {
+  std::vector<uint16_t> program = {
+    0x6073, // 0x200: V0 = 0x73
+    0x6105, // 0x202: V1 = 0x05
+    0xA210, // 0x204: I = 0x210
+    0x2210, // 0x206: call 0x210
+    0xF155, // 0x208: store V0, V1 over 0x210 -> 0x7305
+    0x2210, // 0x20A: call 0x210
+    0x120C, // 0x20C: jump to self
+    0x0000, // 0x20E:
+    0x6300, // 0x210: V3 = 0x00, later V3 += 0x05
+    0x00EE, // 0x212: return
+  };
+
+  auto em_cycle = rem8Cpp();
+  load_program(em_cycle, program);
+  for (int i = 0; i < 20; i++) em_cycle.cycle();
+  EXPECT_EQ(em_cycle.data_register(0x03), 0x05);
+
+  auto em_run = rem8Cpp();
+  load_program(em_run, program);
+  em_run.run(20);
+  EXPECT_EQ(em_run.data_register(0x03), 0x05);
+}
+
+// Loading a new ROM drops instructions decoded from the old one
+TEST(rem8Cpp, load_rom__invalidates_decoded) {
+  auto em = rem8Cpp();
+  load_program(em, {0x6005});
+  em.cycle();
+  EXPECT_EQ(em.data_register(0x00), 0x05);
+
+  load_program(em, {0x6007});
+  em.set_program_counter(0x200);
+  em.cycle();
+  EXPECT_EQ(em.data_register(0x00), 0x07);
+}
+
+// A ROM may fill memory up to its last byte, one past it is turned down
+TEST(rem8Cpp, load_rom__fills_memory) {
+  auto em = rem8Cpp();
+  std::vector<char> rom(0x1000 - 0x200, 0x11);
+  EXPECT_TRUE(em.load_rom(0x200, rom, rom.size()));
+  EXPECT_EQ(em.read_memory(0xFFF), 0x11);
+
+  rom.push_back(0x22);
+  EXPECT_FALSE(em.load_rom(0x200, rom, rom.size()));
+  EXPECT_EQ(em.read_memory(0xFFF), 0x11);
+}
+
+// MEGA-CHIP ROMs keep their data past 64 KB, other profiles turn them down
+TEST(rem8Cpp, load_rom__megachip_past_64k) {
+  std::vector<char> rom(0x30000, 0x00);
+  rom[0x18000 - 0x200] = 0x5A;
+
+  auto em = rem8Cpp();
+  em.set_quirks(rem8Quirks::XoChip);
+  EXPECT_FALSE(em.load_rom(0x200, rom, rom.size()));
+
+  em.set_quirks(rem8Quirks::MegaChip);
+  EXPECT_TRUE(em.load_rom(0x200, rom, rom.size()));
+  EXPECT_EQ(em.read_memory(0x18000), 0x5A);
+  EXPECT_EQ(em.read_memory(0x8000), 0x00);
+}
+
+// I is masked to 12 bits, a store running off the end stays out of the
+// address space and reads back the same way
+TEST(rem8Cpp, memory__I_past_end) {
+  auto em = rem8Cpp();
+  load_program(em, {0x6F42, 0x6033, 0xAFF8, 0xFF55, 0xF055, 0xAFF8, 0x6F00, 0xFF65});
+  em.run(8);
+
+  EXPECT_EQ(em.I_register(), 0x1008);
+  EXPECT_EQ(em.read_memory(0xFF8), 0x33);
+  EXPECT_EQ(em.read_memory(0x007), rem8Cpp().read_memory(0x007));
+  EXPECT_EQ(em.read_memory(0x008), 0x33);
+  EXPECT_EQ(em.data_register(0xF), 0x42);
+}
+
+// The program counter wraps where the next instruction is fetched
+TEST(rem8Cpp, memory__pc_past_end) {
+  for (int engine = 0; engine < 2; engine++) {
+    auto em = engine ? rem8Cpp() : rem8Cpp(rem8Engine::Jit);
+    load_program(em, {0x60FF, 0xBFF3});
+    em.run(2);
+    EXPECT_EQ(em.program_counter(), 0x10F2);
+
+    em.run(1);
+    EXPECT_EQ(em.program_counter(), 0x0F4);
+  }
+}
+
+// Restoring rewinds the guest, including code it has overwritten since
+TEST(rem8Cpp, restore__rewinds_snapshot) {
+  static_assert(std::is_trivially_copyable_v<rem8State>);
+  auto em = rem8Cpp();
+  load_program(em, {0x6005, 0xA200, 0x6107, 0xF055, 0x7001, 0x2200});
+  em.run(4);
+  rem8Snapshot snapshot = em.snapshot();
+
+  em.run(100);
+  EXPECT_NE(em.program_counter(), 0x208);
+  em.restore(snapshot);
+
+  EXPECT_EQ(em.program_counter(), 0x208);
+  EXPECT_EQ(em.stack_pointer(), 0x00);
+  EXPECT_EQ(em.read_memory(0x200), 0x05);
+  em.run(3);
+  EXPECT_EQ(em.data_register(0x00), 0x06);
+  EXPECT_EQ(em.program_counter(), 0x202);
+}
+
+// XO-CHIP memory lives in the extension block, snapshots carry it and
+// profile switches keep what both address spaces share
+TEST(rem8Cpp, restore__xochip_extension) {
+  static_assert(sizeof(rem8State) < 16 * 1024);
+  auto em = rem8Cpp();
+  load_program(em, {0x6042, 0xF000, 0xE000, 0xF055});
+  em.set_quirks(rem8Quirks::XoChip);
+  EXPECT_EQ(em.read_memory(0x200), 0x60);
+  em.run(2);
+  rem8Snapshot snapshot = em.snapshot();
+
+  em.run(1);
+  EXPECT_EQ(em.read_memory(0xE000), 0x42);
+  em.restore(snapshot);
+  EXPECT_EQ(em.read_memory(0xE000), 0x00);
+  em.run(1);
+  EXPECT_EQ(em.read_memory(0xE000), 0x42);
+
+  em.set_quirks(rem8Quirks::Vip);
+  EXPECT_EQ(em.read_memory(0x200), 0x60);
+  em.restore(snapshot);
+  EXPECT_EQ(em.program_counter(), 0x206);
+  EXPECT_EQ(em.read_memory(0x206), 0xF0);
+}
+
+// Superinstructions, entered at their first half, in the middle through a
+// jump or a skip, and cut short by the instruction budget
+TEST(rem8Cpp, run__fused_matches_cycle) {
+  std::vector<uint16_t> program = {
+    0x6000, // 0x200: V0 = 0x00
+    0x6105, // 0x202: V1 = 0x05
+    0x6208, // 0x204: V2 = 0x08
+    0x6300, // 0x206: V3 = 0x00
+    0xA200, // 0x208: I = 0x200           ANNN + DXYN
+    0xD125, // 0x20A: draw at (V1, V2)
+    0x7001, // 0x20C: V0 += 0x01          7XNN + 3XNN
+    0x3010, // 0x20E: skip if V0 == 0x10
+    0x1208, // 0x210: jump to 0x208
+    0x6400, // 0x212: V4 = 0x00           6XNN + 6XNN
+    0x6511, // 0x214: V5 = 0x11           6XNN + 6XNN
+    0x6622, // 0x216: V6 = 0x22
+    0x6733, // 0x218: V7 = 0x33
+    0x7101, // 0x21A: V1 += 0x01          7XNN + 4XNN
+    0x4106, // 0x21C: skip if V1 != 0x06
+    0x1214, // 0x21E: jump into the 6XNN run
+    0x3733, // 0x220: skip into the next pair
+    0x7201, // 0x222: V2 += 0x01          7XNN + 3XNN
+    0x3209, // 0x224: skip if V2 == 0x09
+    0x1222, // 0x226: jump to 0x222
+    0x1228, // 0x228: jump to self
+  };
+
+  auto em_cycle = rem8Cpp();
+  load_program(em_cycle, program);
+  for (int i = 0; i < 600; i++) em_cycle.cycle();
+
+  auto em_run = rem8Cpp();
+  load_program(em_run, program);
+  for (uint32_t done = 0, slice = 1; done < 600; done += slice, slice = slice % 7 + 1) {
+    em_run.run(std::min(slice, 600 - done));
+  }
+
+  EXPECT_EQ(em_run.program_counter(), em_cycle.program_counter());
+  EXPECT_EQ(em_run.I_register(), em_cycle.I_register());
+  for (uint8_t reg = 0x00; reg < 0x10; reg++) {
+    EXPECT_EQ(em_run.data_register(reg), em_cycle.data_register(reg));
+  }
+  EXPECT_TRUE(std::ranges::equal(em_run.get_screen(), em_cycle.get_screen()));
+  EXPECT_EQ(em_run.data_register(0x02), 0x09);
+}
+
+// Rewriting the second half of a superinstruction splits it again
+TEST(rem8Cpp, run__self_modifying_fused_pair) {
+  std::vector<uint16_t> program = {
+    0x6073, // 0x200: V0 = 0x73
+    0x6105, // 0x202: V1 = 0x05
+    0xA212, // 0x204: I = 0x212
+    0x2210, // 0x206: call 0x210
+    0xF155, // 0x208: store V0, V1 over 0x212 -> 0x7305
+    0x2210, // 0x20A: call 0x210
+    0x120C, // 0x20C: jump to self
+    0x0000, // 0x20E:
+    0x6300, // 0x210: V3 = 0x00
+    0x6300, // 0x212: V3 = 0x00, later V3 += 0x05
+    0x00EE, // 0x214: return
+  };
+
+  auto em = rem8Cpp();
+  load_program(em, program);
+  em.run(20);
+  EXPECT_EQ(em.data_register(0x03), 0x05);
+}
+
+// A fusable pair never spans the top of 64 KB memory
+TEST(rem8Cpp, run__no_fusing_across_memory_end) {
+  std::vector<uint16_t> program = {
+    0xA000,         // 0x200: I = 0x000
+    0x6030, 0x6101, // 0x202: V0 = 0x30, V1 = 0x01
+    0xF155,         // 0x206: store 0x3001 at 0x000
+    0xF000, 0xFFFE, // 0x208: I = 0xFFFE
+    0x6070,         // 0x20C: V0 = 0x70
+    0xF155,         // 0x20E: store 0x7001 at 0xFFFE
+    0x1210,         // 0x210: jump to self
+  };
+
+  auto em = rem8Cpp();
+  em.set_quirks(rem8Quirks::XoChip);
+  load_program(em, program);
+  em.run(7);
+  em.set_program_counter(0xFFFE);
+  em.run(2);
+
+  EXPECT_EQ(em.data_register(0x00), 0x71);
+  EXPECT_EQ(em.program_counter(), 0x0002);
+}
+
+TEST(rem8Cpp, run__idle_jump_to_self) {
+  auto em = rem8Cpp();
+  load_program(em, {0x6005, 0x1202});
+
+  EXPECT_EQ(em.run(1000), 0u);
+  EXPECT_EQ(em.cycles(), 1000u);
+  EXPECT_TRUE(em.idle());
+  EXPECT_EQ(em.program_counter(), 0x202);
+  EXPECT_EQ(em.data_register(0x00), 0x05);
+}
+
+// Waits on the delay timer, skipping ahead to each tick until it expires
+TEST(rem8Cpp, run__idle_delay_timer_poll) {
+  std::vector<uint16_t> program = {
+    0x6003, // 0x200: V0 = 0x03
+    0xF015, // 0x202: delay timer = V0
+    0xF007, // 0x204: V0 = delay timer
+    0x3000, // 0x206: skip if V0 == 0x00
+    0x1204, // 0x208: jump to 0x204
+    0x6177, // 0x20A: V1 = 0x77
+    0x120C, // 0x20C: jump to self
+  };
+
+  auto em = rem8Cpp();
+  em.set_clock_rate(600);
+  load_program(em, program);
+  EXPECT_EQ(em.run(25), 0u);
+  EXPECT_EQ(em.delay_timer(), 0x01);
+  EXPECT_EQ(em.data_register(0x01), 0x00);
+
+  EXPECT_EQ(em.run(1000), 0u);
+  EXPECT_TRUE(em.idle());
+  EXPECT_EQ(em.program_counter(), 0x20C);
+  EXPECT_EQ(em.data_register(0x01), 0x77);
+}
+
+// Polling loops that still change state, or leave through a draw and come
+// back, must run their full budget
+TEST(rem8Cpp, run__not_idle_while_state_changes) {
+  auto em_count = rem8Cpp();
+  load_program(em_count, {0xF107, 0x7001, 0x1200});
+  EXPECT_EQ(em_count.run(1000), 0u);
+  EXPECT_FALSE(em_count.idle());
+
+  std::vector<uint16_t> program = {
+    0xF007, // 0x200: V0 = delay timer
+    0x3000, // 0x202: skip if V0 == 0x00
+    0x1200, // 0x204: jump to 0x200
+    0xD001, // 0x206: draw at (V0, V0)
+    0x1204, // 0x208: jump back into the loop
+  };
+  auto em_draw = rem8Cpp();
+  load_program(em_draw, program);
+  EXPECT_EQ(em_draw.run(1000), 0u);
+  EXPECT_FALSE(em_draw.idle());
+}
+
+// Timers tick on fixed cycle boundaries however the budget is split
+TEST(rem8Cpp, run_batch__ticks_timers_on_cycle_boundaries) {
+  std::vector<uint16_t> program = {
+    0x6A28, // 0x200: VA = 0x28
+    0xFA15, // 0x202: delay timer = VA
+    0x7001, // 0x204: V0 += 0x01
+    0x1204, // 0x206: jump to 0x204
+  };
+
+  auto em = rem8Cpp();
+  em.set_clock_rate(6000);
+  load_program(em, program);
+  auto result = em.run_batch(250);
+  EXPECT_EQ(result.cycles, 250u);
+  EXPECT_EQ(result.event, rem8Event::None);
+  EXPECT_EQ(em.delay_timer(), 0x28 - 2);
+  em.run_batch(50);
+  EXPECT_EQ(em.delay_timer(), 0x28 - 3);
+
+  auto em_sliced = rem8Cpp();
+  em_sliced.set_clock_rate(6000);
+  load_program(em_sliced, program);
+  for (uint32_t done = 0; done < 300; done += em_sliced.run_batch(std::min(7u, 300 - done)).cycles);
+  EXPECT_EQ(em_sliced.delay_timer(), em.delay_timer());
+  EXPECT_EQ(em_sliced.data_register(0x00), em.data_register(0x00));
+}
+
+// 60 ticks per clock_rate cycles even when that isn't a whole number of
+// cycles per tick, and a new clock rate keeps the timers' values
+TEST(rem8Cpp, timers__exact_at_any_clock_rate) {
+  auto em = rem8Cpp();
+  em.set_clock_rate(1000);
+  load_program(em, {0x6AFF, 0xFA15, 0xFA18, 0x7001, 0x1206});
+  em.run(1001);
+  EXPECT_EQ(em.cycles(), 1001u);
+  EXPECT_EQ(em.delay_timer(), 0xFF - 60);
+  EXPECT_EQ(em.sound_timer(), 0xFF - 60);
+
+  em.set_clock_rate(120);
+  EXPECT_EQ(em.clock_rate(), 120u);
+  EXPECT_EQ(em.delay_timer(), 0xFF - 60);
+  em.run(240);
+  EXPECT_EQ(em.delay_timer(), 0xFF - 180);
+}
+
+// FX07 inside run() sees the same cycle as when stepped with cycle()
+TEST(rem8Cpp, run__reads_timers_like_cycle) {
+  std::vector<uint16_t> program = {
+    0x6A30, // 0x200: VA = 0x30
+    0xFA15, // 0x202: delay timer = VA
+    0xF007, // 0x204: V0 = delay timer
+    0x8104, // 0x206: V1 += V0
+    0x7201, // 0x208: V2 += 0x01
+    0x1204, // 0x20A: jump to 0x204
+  };
+
+  auto em_cycle = rem8Cpp();
+  auto em_run = rem8Cpp();
+  load_program(em_cycle, program);
+  load_program(em_run, program);
+  for (int i = 0; i < 500; i++) em_cycle.cycle();
+  for (uint32_t done = 0, slice = 1; done < 500; done += slice, slice = slice * 3 % 17 + 1) {
+    em_run.run(std::min(slice, 500 - done));
+  }
+
+  EXPECT_EQ(em_run.cycles(), em_cycle.cycles());
+  EXPECT_EQ(em_run.delay_timer(), em_cycle.delay_timer());
+  EXPECT_EQ(em_run.data_register(0x01), em_cycle.data_register(0x01));
+}
+
+// VIP timing charges machine cycles, DXYN more for unaligned sprites. Budgets
+// ending inside an instruction carry the rest over to the next run.
+TEST(rem8Cpp, timing__vip_charges_machine_cycles) {
+  std::vector<uint16_t> program = {0x6001, 0x6100, 0xA000, 0xD015, 0xD105};
+
+  auto em_cycle = rem8Cpp();
+  em_cycle.set_timing(rem8Timing::Vip);
+  load_program(em_cycle, program);
+  em_cycle.cycle();
+  EXPECT_EQ(em_cycle.cycles(), 46u);
+  em_cycle.cycle();
+  em_cycle.cycle();
+  EXPECT_EQ(em_cycle.cycles(), 144u);
+  em_cycle.cycle();
+  EXPECT_EQ(em_cycle.cycles(), 144u + 66 + 5 * (16 + 4 + 8));
+  em_cycle.cycle();
+  EXPECT_EQ(em_cycle.cycles(), 350u + 66 + 5 * 16);
+
+  for (auto engine : {rem8Engine::Interpreter, rem8Engine::Jit}) {
+    auto em_run = rem8Cpp(engine);
+    em_run.set_timing(rem8Timing::Vip);
+    load_program(em_run, program);
+    for (uint32_t done = 0, slice = 1; done < 496; done += slice, slice = slice * 7 % 61 + 1) {
+      em_run.run(std::min(slice, 496 - done));
+    }
+    EXPECT_EQ(em_run.cycles(), 496u);
+    EXPECT_EQ(em_run.program_counter(), 0x20A);
+    EXPECT_TRUE(std::ranges::equal(em_run.get_screen(), em_cycle.get_screen()));
+  }
+}
+
+// VIP timing runs at the VIP's clock so the timers still tick at 60 Hz, the
+// previous rate comes back with instruction timing
+TEST(rem8Cpp, timing__vip_timers_tick_at_60hz) {
+  auto em = rem8Cpp();
+  em.set_clock_rate(700);
+  em.set_timing(rem8Timing::Vip);
+  EXPECT_EQ(em.clock_rate(), uint32_t{REM8CPP_VIP_CLOCK_RATE});
+
+  load_program(em, {0x603C, 0xF015, 0x1204});
+  em.run(REM8CPP_VIP_CLOCK_RATE / 2);
+  EXPECT_NEAR(em.delay_timer(), 30, 1);
+
+  em.set_timing(rem8Timing::Instructions);
+  EXPECT_EQ(em.clock_rate(), 700u);
+}
+
+TEST(rem8Cpp, run_batch__returns_on_draw) {
+  auto em = rem8Cpp();
+  load_program(em, {0xA000, 0xD001, 0x1200});
+
+  auto result = em.run_batch(100);
+  EXPECT_EQ(result.cycles, 2u);
+  EXPECT_EQ(result.event, rem8Event::Draw);
+  EXPECT_EQ(em.program_counter(), 0x204);
+}
+
+// Time keeps passing for the timers while FX0A waits
+TEST(rem8Cpp, run_batch__returns_on_halt) {
+  auto em = rem8Cpp();
+  em.set_clock_rate(600);
+  load_program(em, {0x6A28, 0xFA15, 0xF00A});
+
+  auto result = em.run_batch(100);
+  EXPECT_EQ(result.cycles, 3u);
+  EXPECT_EQ(result.event, rem8Event::Halt);
+
+  result = em.run_batch(100);
+  EXPECT_EQ(result.cycles, 100u);
+  EXPECT_EQ(result.event, rem8Event::Halt);
+  EXPECT_EQ(em.delay_timer(), 0x28 - 10);
+}
+
+// Idle polling skips ahead to each tick until the delay timer expires
+TEST(rem8Cpp, run_batch__idle_fast_forwards_to_tick) {
+  std::vector<uint16_t> program = {
+    0x6003, // 0x200: V0 = 0x03
+    0xF015, // 0x202: delay timer = V0
+    0xF007, // 0x204: V0 = delay timer
+    0x3000, // 0x206: skip if V0 == 0x00
+    0x1204, // 0x208: jump to 0x204
+    0x6177, // 0x20A: V1 = 0x77
+    0x120C, // 0x20C: jump to self
+  };
+
+  auto em = rem8Cpp();
+  em.set_clock_rate(6000);
+  load_program(em, program);
+  auto result = em.run_batch(1000);
+  EXPECT_EQ(result.cycles, 1000u);
+  EXPECT_GT(result.idle_cycles, 950u);
+  EXPECT_EQ(em.data_register(0x01), 0x77);
+}
+
+TEST(rem8Cpp, quirks__default_vip) {
+  EXPECT_EQ(rem8Cpp().quirks(), rem8Quirks::Vip);
+}
+
+// SUPER-CHIP keeps VF on logic ops, shifts VX in place, leaves I alone on
+// FX55/FX65 and jumps relative to VX
+TEST(rem8Cpp, quirks__schip) {
+  std::vector<uint16_t> program = {
+    0x6F07, // 0x200: VF = 0x07
+    0x6103, // 0x202: V1 = 0x03
+    0x6206, // 0x204: V2 = 0x06
+    0x8121, // 0x206: V1 |= V2
+    0x8326, // 0x208: V3 = V3 >> 1
+    0xA300, // 0x20A: I = 0x300
+    0xF155, // 0x20C: store V0 - V1
+    0x6304, // 0x20E: V3 = 0x04
+    0xB310, // 0x210: jump to 0x310 + V3
+  };
+
+  auto em = rem8Cpp();
+  em.set_quirks(rem8Quirks::Schip);
+  load_program(em, program);
+  for (int i = 0; i < 4; i++) em.cycle();
+  EXPECT_EQ(em.data_register(0x01), 0x07);
+  EXPECT_EQ(em.data_register(0x0F), 0x07);
+
+  for (int i = 0; i < 5; i++) em.cycle();
+  EXPECT_EQ(em.data_register(0x0F), 0x00);
+  EXPECT_EQ(em.I_register(), 0x300);
+  EXPECT_EQ(em.read_memory(0x301), 0x07);
+  EXPECT_EQ(em.program_counter(), 0x314);
+}
+
+// XO-CHIP wraps sprites around the screen edges instead of clipping them
+TEST(rem8Cpp, quirks__xochip_wraps_sprites) {
+  std::vector<uint16_t> program = {
+    0x603E, // 0x200: V0 = 62
+    0x611F, // 0x202: V1 = 31
+    0xA208, // 0x204: I = 0x208
+    0xD012, // 0x206: draw 8x2 at (62, 31)
+    0xF090, // 0x208: sprite data
+  };
+
+  auto em_vip = rem8Cpp();
+  auto em_xo = rem8Cpp();
+  em_xo.set_quirks(rem8Quirks::XoChip);
+  load_program(em_vip, program);
+  load_program(em_xo, program);
+  em_vip.run(4);
+  em_xo.run(4);
+
+  // Both sprite rows run past the right edge and the second one past the bottom
+  std::size_t bottom = 31 * em_vip.width();
+  EXPECT_EQ(em_vip.get_screen()[62 + bottom], 1);
+  EXPECT_EQ(em_vip.get_screen()[0 + bottom], 0);
+  EXPECT_EQ(em_vip.get_screen()[62], 0);
+  EXPECT_EQ(em_xo.get_screen()[62 + bottom], 1);
+  EXPECT_EQ(em_xo.get_screen()[0 + bottom], 1);
+  EXPECT_EQ(em_xo.get_screen()[1 + bottom], 1);
+  EXPECT_EQ(em_xo.get_screen()[62], 1);
+  EXPECT_EQ(em_xo.get_screen()[63], 0);
+  EXPECT_EQ(em_xo.get_screen()[1], 1);
+}
+
+// XO-CHIP addresses 64 KB, F000 NNNN loads I with a full 16-bit address
+TEST(rem8Cpp, quirks__xochip_long_addressing) {
+  std::vector<uint16_t> program = {
+    0xF000, 0xE000, // 0x200: I = 0xE000
+    0x6042,         // 0x204: V0 = 0x42
+    0xF055,         // 0x206: store V0 at 0xE000
+  };
+
+  auto em_vip = rem8Cpp();
+  auto em_xo = rem8Cpp();
+  em_xo.set_quirks(rem8Quirks::XoChip);
+  load_program(em_vip, program);
+  load_program(em_xo, program);
+  em_vip.run(4);  // F000 and E000 do nothing, V0 goes to I = 0
+  em_xo.run(3);
+
+  EXPECT_EQ(em_xo.program_counter(), 0x208);
+  EXPECT_EQ(em_xo.I_register(), 0xE001);
+  EXPECT_EQ(em_xo.read_memory(0xE000), 0x42);
+  EXPECT_EQ(em_vip.I_register(), 0x0001);
+  EXPECT_EQ(em_vip.read_memory(0x0000), 0x42);
+
+  std::vector<char> rom(0xE000, 0x00);
+  rom[0xDE00] = 0x5A;
+  em_vip.load_rom(0x200, rom, rom.size());
+  em_xo.load_rom(0x200, rom, rom.size());
+  EXPECT_EQ(em_vip.read_memory(0x0000), 0x42);  // too big, not loaded
+  EXPECT_EQ(em_xo.read_memory(0xE000), 0x5A);
+}
+
+// A skip steps over F000 NNNN whole with long_addressing
+TEST(rem8Cpp, quirks__xochip_skips_long_instruction) {
+  std::vector<uint16_t> program = {
+    0x3000,         // 0x200: skip if V0 == 0
+    0xF000, 0x1234, // 0x202: I = 0x1234
+    0x6105,         // 0x206: V1 = 5
+  };
+
+  for (int engine = 0; engine < 2; engine++) {
+    auto em = engine ? rem8Cpp() : rem8Cpp(rem8Engine::Jit);
+    em.set_quirks(rem8Quirks::XoChip);
+    load_program(em, program);
+    em.run(2);
+    EXPECT_EQ(em.I_register(), 0x0000);
+    EXPECT_EQ(em.data_register(0x01), 0x05);
+  }
+
+  auto em_vip = rem8Cpp();
+  load_program(em_vip, program);
+  em_vip.run(2);
+  EXPECT_EQ(em_vip.program_counter(), 0x234);  // landed on NNNN, 1234 jumps
+}
+
+// Every profile's tables agree with its reference switch
+TEST(rem8Cpp, quirks__matches_reference) {
+  for (rem8Quirks quirks : {rem8Quirks::Schip, rem8Quirks::XoChip}) {
+    for (uint16_t instr : {0x8121, 0x8122, 0x8123, 0x8126, 0x812E, 0xB204, 0xD125, 0xA300, 0xF155, 0xF165,
+                           0x5122, 0x5213, 0xF201}) {
+      auto em_table = rem8Cpp();
+      auto em_switch = rem8Cpp();
+      em_table.set_quirks(quirks);
+      em_switch.set_quirks(quirks);
+      load_program(em_table, {0x6112, 0x6234, 0x6F01, 0xA300, instr});
+      load_program(em_switch, {0x6112, 0x6234, 0x6F01, 0xA300, instr});
+
+      for (int i = 0; i < 5; i++) {
+        em_table.cycle();
+        em_switch.cycle_reference();
+      }
+
+      ASSERT_EQ(em_table.program_counter(), em_switch.program_counter()) << std::hex << instr;
+      ASSERT_EQ(em_table.I_register(), em_switch.I_register()) << std::hex << instr;
+      ASSERT_TRUE(std::ranges::equal(em_table.get_screen(), em_switch.get_screen())) << std::hex << instr;
+      for (uint8_t reg = 0x00; reg < 0x10; reg++) {
+        ASSERT_EQ(em_table.data_register(reg), em_switch.data_register(reg)) << std::hex << instr;
+      }
+    }
+  }
+}
+
 // Exec subroutine at NNN
 TEST(rem8Cpp_instr, exec_0NNN) {
   GTEST_SKIP();
@@ -71,7 +893,309 @@ TEST(rem8Cpp_instr, exec_00E0) {
 
 // Return from subroutine
 TEST(rem8Cpp_instr, exec_00EE) {
-  GTEST_SKIP();
+  auto em = rem8Cpp();
+  load_program(em, {0x2204, 0x0000, 0x00EE});
+  em.cycle();
+  em.cycle();
+
+  EXPECT_EQ(em.stack_pointer(), 0);
+  EXPECT_EQ(em.program_counter(), 0x202);
+}
+
+// Returning with nothing on the stack faults on the 00EE
+TEST(rem8Cpp_instr, exec_00EE__underflow) {
+  auto em = rem8Cpp();
+  load_program(em, {0x00EE});
+
+  EXPECT_EQ(em.run(10), 9u);
+  EXPECT_EQ(em.fault(), rem8Fault::StackUnderflow);
+  EXPECT_EQ(em.program_counter(), 0x200);
+}
+
+// Scroll down N rows
+TEST(rem8Cpp_instr, exec_00CN) {
+  auto em = rem8Cpp();
+  em.set_quirks(rem8Quirks::Schip);
+  load_program(em, {0xA000, 0xD011, 0x00C3});
+  em.run(3);
+
+  EXPECT_EQ(em.get_screen()[3 * 64], 1);
+  EXPECT_EQ(em.get_screen()[3 * 64 + 3], 1);
+  EXPECT_EQ(em.get_screen()[0], 0);
+}
+
+// Scroll up N rows
+TEST(rem8Cpp_instr, exec_00DN) {
+  auto em = rem8Cpp();
+  em.set_quirks(rem8Quirks::XoChip);
+  load_program(em, {0x6105, 0xA000, 0xD011, 0x00D3});
+  em.run(4);
+
+  EXPECT_EQ(em.get_screen()[2 * 64], 1);
+  EXPECT_EQ(em.get_screen()[2 * 64 + 3], 1);
+  EXPECT_EQ(em.get_screen()[5 * 64], 0);
+}
+
+// Scroll up N rows, whole rows of palette indices in MEGA-CHIP mode
+TEST(rem8Cpp_instr, exec_00BN) {
+  auto em = rem8Cpp();
+  em.set_quirks(rem8Quirks::MegaChip);
+  load_program(em, {0x0011, 0x0301, 0x0402, 0xA20C, 0xD000, 0x00B1, 0x0203});
+  em.run(6);
+
+  EXPECT_EQ(em.get_screen()[0], 0x03);
+  EXPECT_EQ(em.get_screen()[256], 0x00);
+}
+
+// Switch to MEGA-CHIP's 256x192 and back to low resolution, only with the
+// MEGA-CHIP profile
+TEST(rem8Cpp_instr, exec_0010_0011) {
+  auto em = rem8Cpp();
+  load_program(em, {0x0011, 0x0010});
+  em.run(1);
+  EXPECT_FALSE(em.megachip());
+  EXPECT_EQ(em.width(), 64u);
+
+  em.set_quirks(rem8Quirks::MegaChip);
+  em.set_program_counter(0x200);
+  em.run(1);
+  EXPECT_TRUE(em.megachip());
+  EXPECT_EQ(em.width(), 256u);
+  EXPECT_EQ(em.height(), 192u);
+
+  em.run(1);
+  EXPECT_FALSE(em.megachip());
+  EXPECT_EQ(em.width(), 64u);
+  EXPECT_EQ(em.height(), 32u);
+
+  em.set_program_counter(0x200);
+  em.run(1);
+  em.set_quirks(rem8Quirks::Schip);
+  EXPECT_FALSE(em.megachip());
+  EXPECT_EQ(em.width(), 64u);
+}
+
+// Load I with the word that follows in MEGA-CHIP mode, ignored otherwise
+TEST(rem8Cpp_instr, exec_01NN) {
+  auto em = rem8Cpp();
+  em.set_quirks(rem8Quirks::MegaChip);
+  load_program(em, {0x0100, 0x0011, 0x0100, 0x1234, 0x7001});
+  em.run(1);
+  EXPECT_EQ(em.program_counter(), 0x202);
+
+  em.run(3);
+  EXPECT_EQ(em.I_register(), 0x1234);
+  EXPECT_EQ(em.data_register(0x00), 0x01);
+}
+
+// The NN bank byte reaches data past 64 KB
+TEST(rem8Cpp_instr, exec_01NN__bank_byte) {
+  std::vector<char> rom = {0x00, 0x11, 0x01, 0x02, 0x00, 0x10, static_cast<char>(0xF1), 0x65};
+  rom.resize(0x20000);
+  rom[0x20010 - 0x200] = 0x12;
+  rom[0x20011 - 0x200] = 0x34;
+
+  auto em = rem8Cpp();
+  em.set_quirks(rem8Quirks::MegaChip);
+  ASSERT_TRUE(em.load_rom(0x200, rom, rom.size()));
+  em.run(3);
+  EXPECT_EQ(em.I_register(), 0x020010u);
+  EXPECT_EQ(em.data_register(0x00), 0x12);
+  EXPECT_EQ(em.data_register(0x01), 0x34);
+}
+
+// ARGB colours loaded into the palette come out of get_screen_rgba as RGBA
+TEST(rem8Cpp_instr, exec_02NN) {
+  auto em = rem8Cpp();
+  em.set_quirks(rem8Quirks::MegaChip);
+  load_program(em, {0x0011, 0xA20E, 0x0201, 0x0301, 0x0401, 0xA212, 0xD001, 0x8011, 0x2233, 0x0100});
+  em.run(7);
+
+  std::vector<unsigned char> rgba(em.width() * em.height() * 4);
+  em.get_screen_rgba(rgba);
+  EXPECT_EQ(rgba[0], 0x11);
+  EXPECT_EQ(rgba[1], 0x22);
+  EXPECT_EQ(rgba[2], 0x33);
+  EXPECT_EQ(rgba[3], 0x80);
+  EXPECT_EQ(rgba[4], 0x00);
+  EXPECT_EQ(rgba[7], 0xFF);
+}
+
+// Colours read past the top of the 16 MB of memory wrap to address 0
+TEST(rem8Cpp_instr, exec_02NN__wraps_memory) {
+  auto em = rem8Cpp();
+  em.set_quirks(rem8Quirks::MegaChip);
+  load_program(em, {0x0011, 0x01FF, 0xFFF0, 0x02FF});
+  em.run(3);
+
+  const uint32_t* palette = em.palette();
+  for (uint32_t i = 0; i < 0xFF; i++) {
+    uint32_t addr = (0xFFFFF0 + 4 * i) & 0xFFFFFF;
+    uint32_t rgba = em.read_memory(addr + 1) | (em.read_memory(addr + 2) << 8) |
+                    (em.read_memory(addr + 3) << 16) | (uint32_t{em.read_memory(addr)} << 24);
+    ASSERT_EQ(palette[i + 1], rgba) << i;
+  }
+}
+
+// 080N mixes sprite colours into what is on screen, here a colour of
+// 0x10, 0x20, 0x30 at alpha 0x80 drawn twice over the opaque black background
+TEST(rem8Cpp_instr, exec_080N) {
+  const std::vector<std::pair<uint16_t, std::array<unsigned char, 4>>> modes = {
+    {0x0800, {0x10, 0x20, 0x30, 0x80}},
+    {0x0802, {0x0C, 0x18, 0x24, 0x9F}},
+    {0x0804, {0x20, 0x40, 0x60, 0xFF}},
+    {0x0805, {0x00, 0x00, 0x00, 0x40}},
+    {0x080F, {0x10, 0x20, 0x30, 0x80}},
+  };
+  for (const auto& [blend, pixel] : modes) {
+    auto em = rem8Cpp();
+    em.set_quirks(rem8Quirks::MegaChip);
+    load_program(em, {0x0011, 0xA216, 0x0201, 0x0301, 0x0401, 0xA21A, 0x6000, blend, 0xD000, 0xD000, 0x1214,
+                      0x8010, 0x2030, 0x0100});
+    em.run(10);
+
+    std::vector<unsigned char> rgba(em.width() * em.height() * 4);
+    em.get_screen_rgba(rgba);
+    EXPECT_TRUE(std::equal(pixel.begin(), pixel.end(), rgba.begin())) << std::hex << blend;
+    EXPECT_EQ(em.get_screen()[0], 0x01);
+  }
+}
+
+// 05NN fades the picture without touching what was drawn
+TEST(rem8Cpp_instr, exec_05NN) {
+  auto em = rem8Cpp();
+  em.set_quirks(rem8Quirks::MegaChip);
+  load_program(em, {0x0011, 0xA212, 0x0201, 0x0301, 0x0401, 0xA216, 0xD000, 0x0580, 0x05FF, 0xFF40, 0x80C0,
+                    0x0100});
+  em.run(7);
+  em.clear_dirty_rows();
+
+  std::vector<unsigned char> rgba(em.width() * em.height() * 4);
+  em.get_screen_rgba(rgba);
+  EXPECT_EQ(rgba[0], 0x40);
+
+  em.run(1);
+  em.get_screen_rgba(rgba);
+  EXPECT_EQ(rgba[0], 0x20);
+  EXPECT_EQ(rgba[1], 0x40);
+  EXPECT_EQ(rgba[2], 0x60);
+  EXPECT_EQ(rgba[3], 0xFF);
+  EXPECT_EQ(rgba[4], 0x00);
+  EXPECT_EQ(rgba[7], 0xFF);
+  EXPECT_TRUE(em.dirty_rows().all());
+
+  em.run(1);
+  em.get_screen_rgba(rgba);
+  EXPECT_EQ(rgba[0], 0x40);
+}
+
+// Colours stay as drawn when the palette changes, later sprites take the new
+// ones
+TEST(rem8Cpp_instr, exec_02NN__keeps_drawn_colours) {
+  auto em = rem8Cpp();
+  em.set_quirks(rem8Quirks::MegaChip);
+  load_program(em, {0x0011, 0xA21A, 0x0201, 0x0301, 0x0401, 0xA222, 0xD000, 0xA21E, 0x0201, 0xA222, 0x6101,
+                    0xD100, 0x1218, 0xFF11, 0x2233, 0xFF44, 0x5566, 0x0100});
+  em.run(12);
+
+  std::vector<unsigned char> rgba(em.width() * em.height() * 4);
+  em.get_screen_rgba(rgba);
+  EXPECT_EQ(rgba[0], 0x11);
+  EXPECT_EQ(rgba[4], 0x44);
+}
+
+// Scrolls move the colours with the indices and bring in the background
+TEST(rem8Cpp_instr, exec_00BN__moves_colours) {
+  auto em = rem8Cpp();
+  em.set_quirks(rem8Quirks::MegaChip);
+  load_program(em, {0x0011, 0xA216, 0x0201, 0x0301, 0x0401, 0x6001, 0xA21A, 0xD000, 0x00B1, 0x00C2, 0x1214,
+                    0xFF11, 0x2233, 0x0100});
+  em.run(9);
+
+  std::vector<unsigned char> rgba(em.width() * em.height() * 4);
+  em.get_screen_rgba(rgba);
+  EXPECT_EQ(em.get_screen()[1], 0x01);
+  EXPECT_EQ(rgba[4 * 1], 0x11);
+  EXPECT_EQ(rgba[4 * 257], 0x00);
+  EXPECT_EQ(rgba[4 * 257 + 3], 0xFF);
+
+  em.run(1);
+  em.get_screen_rgba(rgba);
+  EXPECT_EQ(em.get_screen()[2 * 256 + 1], 0x01);
+  EXPECT_EQ(rgba[4 * (2 * 256 + 1)], 0x11);
+  EXPECT_EQ(rgba[4 * 1], 0x00);
+  EXPECT_EQ(rgba[4 * 1 + 3], 0xFF);
+}
+
+// Scrolls and clears only touch the selected planes
+TEST(rem8Cpp_instr, exec_00CN__selected_planes) {
+  auto em = rem8Cpp();
+  em.set_quirks(rem8Quirks::XoChip);
+  load_program(em, {0xF301, 0xA210, 0xD001, 0xF201, 0x00C2, 0x00FB, 0xF101, 0x00E0, 0xF0F0});
+  em.run(6);
+
+  EXPECT_EQ(em.get_screen()[0], 0x01);
+  EXPECT_EQ(em.get_screen()[3], 0x01);
+  EXPECT_EQ(em.get_screen()[2 * 64 + 4], 0x02);
+  EXPECT_EQ(em.get_screen()[2 * 64 + 7], 0x02);
+  EXPECT_EQ(em.get_screen()[2 * 64], 0x00);
+
+  em.run(2);
+  EXPECT_EQ(em.get_screen()[0], 0x00);
+  EXPECT_EQ(em.get_screen()[2 * 64 + 4], 0x02);
+}
+
+// Scroll right then left 4 pixels, pixels pushed off the edge are lost
+TEST(rem8Cpp_instr, exec_00FB_00FC) {
+  auto em = rem8Cpp();
+  em.set_quirks(rem8Quirks::Schip);
+  load_program(em, {0x6038, 0xA000, 0xD011, 0x00FB});
+  em.run(4);
+  EXPECT_EQ(em.get_screen()[0x3C], 1);
+  EXPECT_EQ(em.get_screen()[0x3F], 1);
+  EXPECT_EQ(em.get_screen()[64], 0);
+
+  load_program(em, {0x00FC, 0x00FC});
+  em.set_program_counter(0x200);
+  em.run(2);
+  EXPECT_EQ(em.get_screen()[0x34], 1);
+  EXPECT_EQ(em.get_screen()[0x37], 1);
+  EXPECT_EQ(em.get_screen()[0x38], 0);
+}
+
+// Exit the interpreter
+TEST(rem8Cpp_instr, exec_00FD) {
+  auto em = rem8Cpp();
+  em.set_quirks(rem8Quirks::Schip);
+  load_program(em, {0x7001, 0x00FD, 0x7001});
+
+  EXPECT_EQ(em.run_batch(100).event, rem8Event::Exit);
+  EXPECT_TRUE(em.exited());
+  EXPECT_EQ(em.run(10), 10u);
+  EXPECT_EQ(em.data_register(0x00), 0x01);
+
+  em.set_program_counter(0x204);
+  EXPECT_FALSE(em.exited());
+}
+
+// Switch between low and high resolution, clearing the screen
+TEST(rem8Cpp_instr, exec_00FE_00FF) {
+  auto em = rem8Cpp();
+  em.set_quirks(rem8Quirks::Schip);
+  load_program(em, {0xA000, 0xD015, 0x00FF, 0x607F, 0x613F, 0xD011, 0x00FE});
+  em.run(2);
+  EXPECT_EQ(em.width(), 64u);
+  EXPECT_EQ(em.height(), 32u);
+
+  em.run(4);
+  EXPECT_EQ(em.width(), 128u);
+  EXPECT_EQ(em.height(), 64u);
+  EXPECT_EQ(em.get_screen()[0], 0);
+  EXPECT_EQ(em.get_screen()[127 + 63 * 128], 1);  // clipped at the bottom right
+
+  em.run(1);
+  EXPECT_EQ(em.width(), 64u);
+  EXPECT_TRUE(std::ranges::all_of(em.get_screen(), [](uint8_t pixel) { return pixel == 0; }));
 }
 
 // Jump to address NNN
@@ -86,31 +1210,45 @@ TEST(rem8Cpp_instr, exec_1NNN) {
   EXPECT_EQ(pc, instr & 0x0FFF);
 }
 
-// Execute subroutine at address NNN, pushes current SP to stack
+// Execute subroutine at address NNN, pushes the return address to the stack
 TEST(rem8Cpp_instr, exec_2NNN) {
   auto em = rem8Cpp();
   auto instr = 0x2234;
 
-  auto pc_shifted = em.program_counter() + 0x2;
   auto sp_init = em.stack_pointer();
   load_instruction_at_pc(em, instr);
 
   em.cycle();
 
-  // stack pointer moved
-  auto sp_curr = em.stack_pointer();
-  EXPECT_NE(sp_init, sp_curr);
-  EXPECT_EQ(sp_init, sp_curr + 2);
-
-  // previous SP (shifted) pushed to stack
-  EXPECT_EQ(em.read_memory(sp_curr + 1), pc_shifted >> 8 & 0xFF);
-  EXPECT_EQ(em.read_memory(sp_curr + 2), pc_shifted & 0xFF);
+  // one return address pushed, guest memory left alone
+  auto em_fresh = rem8Cpp();
+  EXPECT_EQ(em.stack_pointer(), sp_init + 1);
+  for (uint16_t addr = 0x000; addr < 0x200; addr++) {
+    EXPECT_EQ(em.read_memory(addr), em_fresh.read_memory(addr)) << std::hex << addr;
+  }
 
   // moved to new address
   auto pc_curr = em.program_counter();
   EXPECT_EQ(pc_curr, instr & 0x0FFF);
 }
 
+// Recursing past the stack's depth faults on the call and stops the core
+TEST(rem8Cpp_instr, exec_2NNN__overflow) {
+  auto em = rem8Cpp();
+  load_program(em, {0x7001, 0x2200});
+
+  auto result = em.run_batch(1000);
+  EXPECT_EQ(result.event, rem8Event::Fault);
+  EXPECT_EQ(em.fault(), rem8Fault::StackOverflow);
+  EXPECT_EQ(em.stack_pointer(), 0x10);
+  EXPECT_EQ(em.data_register(0x00), 0x11);
+  EXPECT_EQ(em.program_counter(), 0x202);
+  EXPECT_EQ(em.run(10), 10u);
+
+  em.set_program_counter(0x200);
+  EXPECT_EQ(em.fault(), rem8Fault::None);
+}
+
 // Skip following instruction if VX == NN
 TEST(rem8Cpp_instr, exec_3XNN) {
   GTEST_SKIP();
@@ -126,6 +1264,32 @@ TEST(rem8Cpp_instr, exec_5XY0) {
   GTEST_SKIP();
 }
 
+// Store V1 to V3 at addr register, then load them back in reverse order
+TEST(rem8Cpp_instr, exec_5XY2_5XY3) {
+  auto em = rem8Cpp();
+  em.set_quirks(rem8Quirks::XoChip);
+  load_program(em, {0x6111, 0x6222, 0x6333, 0xA300, 0x5132, 0x5313});
+  em.run(6);
+
+  EXPECT_EQ(em.read_memory(0x300), 0x11);
+  EXPECT_EQ(em.read_memory(0x302), 0x33);
+  EXPECT_EQ(em.I_register(), 0x300);
+  EXPECT_EQ(em.data_register(0x01), 0x33);
+  EXPECT_EQ(em.data_register(0x02), 0x22);
+  EXPECT_EQ(em.data_register(0x03), 0x11);
+}
+
+// Without XO-CHIP opcodes 5XY2 is the 5XY0 skip and leaves memory alone
+TEST(rem8Cpp_instr, exec_5XY2__vip) {
+  auto em = rem8Cpp();
+  load_program(em, {0x6111, 0x6211, 0xA300, 0x5122, 0x6305, 0x6406});
+  em.run(5);
+
+  EXPECT_EQ(em.read_memory(0x300), 0x00);
+  EXPECT_EQ(em.data_register(0x03), 0x00);
+  EXPECT_EQ(em.data_register(0x04), 0x06);
+}
+
 // Store value of NN in VX
 TEST(rem8Cpp_instr, exec_6XNN) {
   auto em = rem8Cpp();
@@ -351,7 +1515,33 @@ TEST(rem8Cpp_instr, exec_CXNN) {
   em.cycle();
 
   auto reg_val = em.data_register(0x04);
-  EXPECT_EQ(reg_val & !0xAA, 0x00);
+  EXPECT_EQ(reg_val & ~0xAA, 0x00);
+}
+
+// Every byte comes up, and a seed replays the same sequence
+TEST(rem8Cpp_instr, exec_CXNN__seeded) {
+  auto em = rem8Cpp();
+  auto em_same = rem8Cpp();
+  auto em_other = rem8Cpp();
+  em.seed(7);
+  em_same.seed(7);
+  em_other.seed(8);
+  load_program(em, {0xC0FF, 0x1200});
+  load_program(em_same, {0xC0FF, 0x1200});
+  load_program(em_other, {0xC0FF, 0x1200});
+
+  std::vector<bool> seen(0x100, false);
+  int differ = 0;
+  for (int i = 0; i < 4096; i++) {
+    em.run(2);
+    em_same.run(2);
+    em_other.run(2);
+    seen[em.data_register(0x00)] = true;
+    ASSERT_EQ(em.data_register(0x00), em_same.data_register(0x00));
+    differ += em.data_register(0x00) != em_other.data_register(0x00);
+  }
+  EXPECT_EQ(std::count(seen.begin(), seen.end(), true), 0x100);
+  EXPECT_GT(differ, 4000);
 }
 
 // Draw sprite at (VX, VY) 8px wide and Npx tall
@@ -359,6 +1549,55 @@ TEST(rem8Cpp_instr, exec_DXYN) {
   GTEST_SKIP();
 }
 
+// Draw a 16x16 sprite at (VX, VY), clipped or wrapped at the right edge
+TEST(rem8Cpp_instr, exec_DXY0) {
+  std::vector<uint16_t> program = {0x00FF, 0x607C, 0xA20A, 0xD010, 0xD010};
+  program.resize(program.size() + 16, 0xFFFF);
+
+  auto em = rem8Cpp();
+  em.set_quirks(rem8Quirks::Schip);
+  load_program(em, program);
+  em.run(4);
+  EXPECT_EQ(em.get_screen()[124], 1);
+  EXPECT_EQ(em.get_screen()[127 + 15 * 128], 1);
+  EXPECT_EQ(em.get_screen()[124 + 16 * 128], 0);
+  EXPECT_EQ(em.get_screen()[0], 0);
+  EXPECT_EQ(em.data_register(0x0F), 0x00);
+
+  em.run(1);
+  EXPECT_EQ(em.get_screen()[124], 0);
+  EXPECT_EQ(em.data_register(0x0F), 0x01);
+
+  auto em_xo = rem8Cpp();
+  em_xo.set_quirks(rem8Quirks::XoChip);
+  load_program(em_xo, program);
+  em_xo.run(4);
+  EXPECT_EQ(em_xo.get_screen()[124], 1);
+  EXPECT_EQ(em_xo.get_screen()[11 + 15 * 128], 1);
+  EXPECT_EQ(em_xo.get_screen()[12], 0);
+}
+
+// MEGA-CHIP sprites take their size from 03NN and 04NN, index 0 is
+// transparent and VF reports drawing over the 09NN collision colour
+TEST(rem8Cpp_instr, exec_DXYN__megachip) {
+  auto em = rem8Cpp();
+  em.set_quirks(rem8Quirks::MegaChip);
+  load_program(em, {0x0011, 0x0303, 0x0402, 0x0905, 0x6010, 0xA214, 0xD010, 0xD010, 0x1210, 0x0000,
+                    0x0500, 0x0700, 0x0500});
+  em.run(7);
+
+  EXPECT_EQ(em.get_screen()[0x10], 0x05);
+  EXPECT_EQ(em.get_screen()[0x11], 0x00);
+  EXPECT_EQ(em.get_screen()[0x12], 0x07);
+  EXPECT_EQ(em.get_screen()[256 + 0x10], 0x00);
+  EXPECT_EQ(em.get_screen()[256 + 0x11], 0x05);
+  EXPECT_EQ(em.data_register(0x0F), 0x00);
+
+  em.run(1);
+  EXPECT_EQ(em.get_screen()[0x10], 0x05);
+  EXPECT_EQ(em.data_register(0x0F), 0x01);
+}
+
 // Skip following instruction if key == VX
 TEST(rem8Cpp_instr, exec_EX9E) {
   GTEST_SKIP();
@@ -369,6 +1608,44 @@ TEST(rem8Cpp_instr, exec_EXA1) {
   GTEST_SKIP();
 }
 
+// Load I with the word that follows, and step over it
+TEST(rem8Cpp_instr, exec_F000) {
+  auto em = rem8Cpp();
+  em.set_quirks(rem8Quirks::XoChip);
+  load_program(em, {0xF000, 0xABCD, 0x7001});
+  em.run(2);
+
+  EXPECT_EQ(em.I_register(), 0xABCD);
+  EXPECT_EQ(em.data_register(0x00), 0x01);
+}
+
+// Sprite data for each selected plane follows the previous plane's, pixels
+// lit in both planes get the fourth colour
+TEST(rem8Cpp_instr, exec_FN01) {
+  auto em = rem8Cpp();
+  em.set_quirks(rem8Quirks::XoChip);
+  load_program(em, {0xF301, 0xA20C, 0xD001, 0xF001, 0xD001, 0x120A, 0xCCF0});
+  em.run(3);
+
+  EXPECT_EQ(em.get_screen()[0], 0x03);
+  EXPECT_EQ(em.get_screen()[2], 0x02);
+  EXPECT_EQ(em.get_screen()[4], 0x01);
+  EXPECT_EQ(em.get_screen()[6], 0x00);
+  EXPECT_EQ(em.data_register(0x0F), 0x00);
+
+  std::vector<unsigned char> rgba(em.width() * em.height() * 4);
+  em.get_screen_rgba(rgba);
+  EXPECT_EQ(rgba[0 * 4], 0x55);
+  EXPECT_EQ(rgba[2 * 4], 0xAA);
+  EXPECT_EQ(rgba[4 * 4], 0xFF);
+  EXPECT_EQ(rgba[6 * 4], 0x00);
+  EXPECT_EQ(rgba[6 * 4 + 3], 0xFF);
+
+  em.run(2);  // no planes selected, nothing is drawn
+  EXPECT_EQ(em.get_screen()[0], 0x03);
+  EXPECT_EQ(em.data_register(0x0F), 0x00);
+}
+
 // Store delay timer into VX
 TEST(rem8Cpp_instr, exec_FX07) {
   auto em = rem8Cpp();
@@ -388,7 +1665,28 @@ TEST(rem8Cpp_instr, exec_FX07) {
 
 // Wait for keypress and store result in VX
 TEST(rem8Cpp_instr, exec_FX0A) {
-  GTEST_SKIP();
+  auto em = rem8Cpp();
+  set_register(em, 0x04, 0x00);
+
+  auto instr = 0xF40A;
+  load_instruction_at_pc(em, instr);
+  auto pc = em.program_counter();
+  em.cycle();
+  EXPECT_TRUE(em.blocked());
+
+  // nothing runs while blocked
+  em.cycle();
+  EXPECT_EQ(em.run(100), 100u);
+  EXPECT_EQ(em.program_counter(), pc + 2);
+
+  // wakes on release of a key pressed while waiting
+  em.unset_key(0x5);
+  EXPECT_TRUE(em.blocked());
+  em.set_key(0x5);
+  EXPECT_TRUE(em.blocked());
+  em.unset_key(0x5);
+  EXPECT_FALSE(em.blocked());
+  EXPECT_EQ(em.data_register(0x04), 0x05);
 }
 
 // Set delay timer to value of VX
@@ -438,6 +1736,18 @@ TEST(rem8Cpp_instr, exec_FX29) {
   GTEST_SKIP();
 }
 
+// Set addr register to the 8x10 sprite of VX
+TEST(rem8Cpp_instr, exec_FX30) {
+  auto em = rem8Cpp();
+  em.set_quirks(rem8Quirks::Schip);
+  load_program(em, {0x6007, 0xF030});
+  em.run(2);
+
+  EXPECT_EQ(em.I_register(), 0x50 + 7 * 10);
+  EXPECT_EQ(em.read_memory(em.I_register()), 0xFF);
+  EXPECT_EQ(em.read_memory(em.I_register() + 9), 0x18);
+}
+
 // Store BCD of VX at addr of addr register
 TEST(rem8Cpp_instr, exec_FX33) {
   GTEST_SKIP();
@@ -453,3 +1763,15 @@ TEST(rem8Cpp_instr, exec_FX65) {
   GTEST_SKIP();
 }
 
+// Store V0 to VX in the RPL flags, then read them back
+TEST(rem8Cpp_instr, exec_FX75_FX85) {
+  auto em = rem8Cpp();
+  em.set_quirks(rem8Quirks::Schip);
+  load_program(em, {0x6011, 0x6122, 0x6233, 0xF175, 0x6000, 0x6100, 0x6200, 0xF285});
+  em.run(8);
+
+  EXPECT_EQ(em.data_register(0x00), 0x11);
+  EXPECT_EQ(em.data_register(0x01), 0x22);
+  EXPECT_EQ(em.data_register(0x02), 0x00);
+}
+
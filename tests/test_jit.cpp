@@ -0,0 +1,282 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <random>
+
+#include "emulator.h"
+#include "jit/jit.h"
+
+
+// Helper Functions - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - //
+
+void load_program(rem8Cpp& emulator, const std::vector<uint16_t>& instrs) {
+  std::vector<char> program;
+  for (auto instr : instrs) {
+    program.push_back((instr & 0xFF00) >> 8);
+    program.push_back(instr & 0x00FF);
+  }
+  emulator.load_rom(0x200, program, program.size());
+}
+
+// Run the program on both engines and check they end up in the same state
+void expect_engines_match(const std::vector<uint16_t>& program, uint32_t count, rem8Quirks quirks = rem8Quirks::Vip) {
+  auto em_interp = rem8Cpp(rem8Engine::Interpreter);
+  auto em_jit = rem8Cpp(rem8Engine::Jit);
+  em_interp.set_quirks(quirks);
+  em_jit.set_quirks(quirks);
+  load_program(em_interp, program);
+  load_program(em_jit, program);
+
+  // Uneven slices so blocks get cut short by the instruction budget too
+  for (uint32_t done = 0, slice = 1; done < count; done += slice, slice = slice * 3 % 17 + 1) {
+    em_interp.run(slice);
+    em_jit.run(slice);
+  }
+
+  ASSERT_EQ(em_jit.program_counter(), em_interp.program_counter());
+  ASSERT_EQ(em_jit.fault(), em_interp.fault());
+  ASSERT_EQ(em_jit.I_register(), em_interp.I_register());
+  ASSERT_EQ(em_jit.stack_pointer(), em_interp.stack_pointer());
+  ASSERT_EQ(em_jit.delay_timer(), em_interp.delay_timer());
+  ASSERT_EQ(em_jit.sound_timer(), em_interp.sound_timer());
+  for (uint8_t reg = 0x00; reg < 0x10; reg++) {
+    ASSERT_EQ(em_jit.data_register(reg), em_interp.data_register(reg)) << "V" << std::hex << int(reg);
+  }
+  for (uint16_t addr = 0x000; addr < 0xFFF; addr++) {
+    ASSERT_EQ(em_jit.read_memory(addr), em_interp.read_memory(addr)) << std::hex << addr;
+  }
+  ASSERT_TRUE(std::ranges::equal(em_jit.get_screen(), em_interp.get_screen()));
+}
+
+// Tests - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - //
+
+TEST(rem8Jit, engine__selected_at_construction) {
+  EXPECT_EQ(rem8Cpp().engine(), rem8Engine::Interpreter);
+  EXPECT_EQ(rem8Cpp(rem8Engine::Jit).engine(), rem8Engine::Jit);
+}
+
+// Every 8XYN variant and register pairing, with all 16 registers live so
+// blocks also run out of host registers
+TEST(rem8Jit, alu__matches_interpreter) {
+  for (rem8Quirks quirks : {rem8Quirks::Vip, rem8Quirks::Schip}) {
+    for (uint16_t N : {0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0xE}) {
+      for (uint16_t X = 0x0; X < 0x10; X++) {
+        for (uint16_t Y = 0x0; Y < 0x10; Y++) {
+          std::vector<uint16_t> program;
+          for (uint16_t reg = 0x0; reg < 0x10; reg++) {
+            program.push_back(0x6000 | (reg << 8) | ((reg * 0x35 + 0x91) & 0xFF));
+          }
+          program.push_back(0x8000 | (X << 8) | (Y << 4) | N); // 0x220
+          program.push_back(0x7005 | (X << 8));                // 0x222
+          program.push_back(0x3010 | (X << 8));                // 0x224
+          program.push_back(0x1220);                           // 0x226
+          program.push_back(0x1228);                           // 0x228
+          expect_engines_match(program, 300, quirks);
+        }
+      }
+    }
+  }
+}
+
+// Switching profiles drops blocks translated for the old one
+TEST(rem8Jit, set_quirks__retranslates) {
+  std::vector<uint16_t> program = {0x6F05, 0x6103, 0x8126, 0x1206};
+  auto em = rem8Cpp(rem8Engine::Jit);
+  load_program(em, program);
+  em.run(4);
+  EXPECT_EQ(em.data_register(0x01), 0x00);
+
+  em.set_quirks(rem8Quirks::Schip);
+  em.set_program_counter(0x200);
+  em.run(4);
+  EXPECT_EQ(em.data_register(0x01), 0x01);
+  EXPECT_EQ(em.data_register(0x0F), 0x01);
+}
+
+// Random straight-line and branching register code
+TEST(rem8Jit, random_programs__match_interpreter) {
+  std::mt19937 rng(0x8C8);
+  auto rand_byte = [&] { return static_cast<uint16_t>(rng() & 0xFF); };
+  auto rand_reg = [&] { return static_cast<uint16_t>(rng() & 0x0F); };
+
+  const uint16_t length = 48;
+  for (int trial = 0; trial < 300; trial++) {
+    std::vector<uint16_t> program;
+    for (uint16_t i = 0; i < length; i++) {
+      uint16_t jump = 0x200 + 2 * (rng() % (length + 2));
+      uint16_t X = rand_reg() << 8;
+      uint16_t Y = rand_reg() << 4;
+      switch (rng() % 14) {
+        case 0:  program.push_back(0x6000 | X | rand_byte()); break;
+        case 1:  program.push_back(0x7000 | X | rand_byte()); break;
+        case 2:  program.push_back(0x8000 | X | Y | (rng() % 8)); break;
+        case 3:  program.push_back(0x800E | X | Y); break;
+        case 4:  program.push_back(0x3000 | X | rand_byte()); break;
+        case 5:  program.push_back(0x4000 | X | rand_byte()); break;
+        case 6:  program.push_back(0x5000 | X | Y); break;
+        case 7:  program.push_back(0x9000 | X | Y); break;
+        case 8:  program.push_back(0x1000 | jump); break;
+        case 9:  program.push_back(0xA000 | (rng() & 0x0FFF)); break;
+        case 10: program.push_back(0xF01E | X); break;
+        case 11: program.push_back(0xF015 | X); break;
+        case 12: program.push_back(0xF007 | X); break;
+        default: program.push_back(0xF018 | X); break;
+      }
+    }
+    program.push_back(0x1000 | (0x200 + 2 * length));
+    program.push_back(0x1000 | (0x202 + 2 * length));
+    expect_engines_match(program, 2000);
+  }
+}
+
+// Instructions the JIT hands back to the interpreter, mixed with native ones
+TEST(rem8Jit, interpreted_instructions__match_interpreter) {
+  std::vector<uint16_t> program = {
+    0x6A05, // 0x200: VA = 0x05
+    0x6B00, // 0x202: VB = 0x00
+    0x00E0, // 0x204: clear screen
+    0xFA29, // 0x206: I = sprite VA
+    0xDAB5, // 0x208: draw at (VA, VB)
+    0x2220, // 0x20A: call 0x220
+    0x7B03, // 0x20C: VB += 0x03
+    0x3B1E, // 0x20E: skip if VB == 0x1E
+    0x1204, // 0x210: jump to 0x204
+    0x1212, // 0x212: jump to self
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0xA300, // 0x220: I = 0x300
+    0xFB33, // 0x222: BCD of VB at 0x300
+    0xF265, // 0x224: V0 - V2 = BCD digits
+    0x8024, // 0x226: V0 += V2
+    0x00EE, // 0x228: return
+  };
+  expect_engines_match(program, 500);
+}
+
+// Code rewritten by FX55 drops the translated block
+TEST(rem8Jit, self_modifying_code__invalidates_block) {
+  std::vector<uint16_t> program = {
+    0x6073, // 0x200: V0 = 0x73
+    0x6105, // 0x202: V1 = 0x05
+    0xA210, // 0x204: I = 0x210
+    0x2210, // 0x206: call 0x210
+    0xF155, // 0x208: store V0, V1 over 0x210 -> 0x7305
+    0x2210, // 0x20A: call 0x210
+    0x120C, // 0x20C: jump to self
+    0x0000, // 0x20E:
+    0x6300, // 0x210: V3 = 0x00, later V3 += 0x05
+    0x00EE, // 0x212: return
+  };
+
+  auto em = rem8Cpp(rem8Engine::Jit);
+  load_program(em, program);
+  em.run(20);
+  EXPECT_EQ(em.data_register(0x03), 0x05);
+
+  expect_engines_match(program, 20);
+}
+
+// The loop closing 1NNN is handed to the interpreter so idle loops are
+// still detected
+TEST(rem8Jit, run__idle_delay_timer_poll) {
+  std::vector<uint16_t> program = {
+    0x6003, // 0x200: V0 = 0x03
+    0xF015, // 0x202: delay timer = V0
+    0xF007, // 0x204: V0 = delay timer
+    0x3000, // 0x206: skip if V0 == 0x00
+    0x1204, // 0x208: jump to 0x204
+    0x120A, // 0x20A: jump to self
+  };
+
+  auto em = rem8Cpp(rem8Engine::Jit);
+  em.set_clock_rate(600);
+  load_program(em, program);
+  EXPECT_EQ(em.run(25), 0u);
+  EXPECT_EQ(em.delay_timer(), 0x01);
+
+  EXPECT_EQ(em.run(1000), 0u);
+  EXPECT_TRUE(em.idle());
+  EXPECT_EQ(em.program_counter(), 0x20A);
+  EXPECT_EQ(em.cycles(), 1025u);
+}
+
+// A PC the JIT had to leave to the interpreter is looked at again once the
+// code there changes
+TEST(rem8Jit, invalidate__retranslates_untranslated_block) {
+  auto em = rem8Cpp(rem8Engine::Interpreter);
+  load_program(em, {0xC0FF, 0x1202}); // V0 = random, then jump to self
+  rem8Jit jit;
+  if (!jit.valid()) GTEST_SKIP() << "JIT unsupported on this host";
+
+  jit.run(em, 1);
+  EXPECT_FALSE(jit.has_code(0x200));
+
+  load_program(em, {0x6005, 0x1202}); // V0 = 0x05, then jump to self
+  jit.invalidate(em, 0x200, 2);
+  em.set_program_counter(0x200);
+  jit.run(em, 1);
+  EXPECT_TRUE(jit.has_code(0x200));
+  EXPECT_EQ(em.data_register(0x00), 0x05);
+}
+
+// Calls and returns are translated, faulting on the stack like the
+// interpreter does
+TEST(rem8Jit, stack__matches_interpreter) {
+  std::vector<uint16_t> program = {
+    0x2206, // 0x200: call 0x206
+    0x7101, // 0x202: V1 += 0x01
+    0x1200, // 0x204: jump to 0x200
+    0x7001, // 0x206: V0 += 0x01
+    0x3004, // 0x208: skip if V0 == 0x04
+    0x2206, // 0x20A: call 0x206
+    0x00EE, // 0x20C: return
+  };
+  expect_engines_match(program, 700);
+  expect_engines_match({0x7001, 0x2200}, 100);  // overflows the stack
+  expect_engines_match({0x6005, 0x00EE}, 10);   // returns with an empty stack
+}
+
+// A batch run stops after a translated draw as it does after an
+// interpreted one
+TEST(rem8Jit, run_batch__stops_on_draw) {
+  std::vector<uint16_t> program = {
+    0x6001, // 0x200: V0 = 0x01
+    0xD005, // 0x202: draw at (V0, V0)
+    0x7001, // 0x204: V0 += 0x01
+    0x1202, // 0x206: jump to 0x202
+  };
+  auto em_interp = rem8Cpp(rem8Engine::Interpreter);
+  auto em_jit = rem8Cpp(rem8Engine::Jit);
+  load_program(em_interp, program);
+  load_program(em_jit, program);
+
+  for (int frame = 0; frame < 4; frame++) {
+    auto expected = em_interp.run_batch(100);
+    auto result = em_jit.run_batch(100);
+    EXPECT_EQ(result.cycles, expected.cycles);
+    EXPECT_EQ(result.event, rem8Event::Draw);
+    EXPECT_EQ(em_jit.program_counter(), em_interp.program_counter());
+    EXPECT_EQ(em_jit.data_register(0x00), em_interp.data_register(0x00));
+  }
+  EXPECT_TRUE(std::ranges::equal(em_jit.get_screen(), em_interp.get_screen()));
+}
+
+// XO-CHIP code past the first 4 KB is translated as well
+TEST(rem8Jit, long_addressing__translates_past_4k) {
+  std::vector<char> program = {
+    0x60, 0x00, // 0x8000: V0 = 0x00
+    0x70, 0x03, // 0x8002: V0 += 0x03
+    0x21, 0x00, // 0x8004: call 0x100
+  };
+  auto em = rem8Cpp(rem8Engine::Interpreter);
+  em.set_quirks(rem8Quirks::XoChip);
+  ASSERT_TRUE(em.load_rom(0x8000, program, program.size()));
+  em.set_program_counter(0x8000);
+
+  rem8Jit jit;
+  if (!jit.valid()) GTEST_SKIP() << "JIT unsupported on this host";
+  jit.run(em, 3);
+  EXPECT_TRUE(jit.has_code(0x8000));
+  EXPECT_EQ(em.data_register(0x00), 0x03);
+  EXPECT_EQ(em.program_counter(), 0x100);
+  EXPECT_EQ(em.stack_pointer(), 1);
+}